@@ -25,16 +25,17 @@
 // This tool manipulates 3D image cubes generated by the `ray4` 4D raytracer.
 //==================================================================================================
 
-#include "r4_image.h"
+#include "r4_imagecube.h"
+#include "r4_pool.h"
+#include "r4_ppm.h"
 
-#include <fstream>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <string>
 #include <vector>
 
 using namespace std;
-using ImageHeader = ImageHeader_1;
 
 
 //__________________________________________________________________________________________________
@@ -49,6 +50,7 @@ usage:  image4 [-h|--help] [-v|--version]
                [-q|--query]
                [-o|--output <outputImageFile>]
                [-s|--slice <start>[-<end>][x<stepSize>]]
+               [-t|--threads <threadCount>]
 
 This tool reads a 3D image cube produced by the ray4 4D ray tracer, and either
 reports information about the file, or generates one or more images from that
@@ -76,7 +78,8 @@ image cube, depending on the command line options.
     (exactly two consecutive hash characters), which will be replaced with the
     slice index, with leading zeros so that all output file names have the same
     length. If the output file name does not contain this substring, the slice
-    index will be appended to the end if more than one slice is requested.
+    index will be appended to the file name (ahead of any file extension) if
+    more than one slice is requested.
 
 -f, --format <Output Image File Format>
     The default output image file format is binary PPM. Supported explicit
@@ -97,6 +100,10 @@ image cube, depending on the command line options.
     range ('--slice x5'), offset to end of cube ('--slice 20x5'), and stepped
     range ('--slice 20-80x10').
 
+-t, --threads <threadCount>
+    Optional. The number of threads used to encode output image slices in
+    parallel. The default value of zero uses one thread per processor.
+
 )";
 
 //__________________________________________________________________________________________________
@@ -136,6 +143,7 @@ struct Parameters {
     int        sliceStart{0};                 // First slice to output
     int        sliceEnd{-1};                  // Last output slice. -1 indicates last slice
     int        sliceStep{1};                  // Step size between slices
+    int        threads{0};                    // Encoding threads (0 -> all processors)
 };
 
 enum class OptionType {
@@ -146,6 +154,7 @@ enum class OptionType {
     OutputFileName,
     Format,
     Slice,
+    Threads,
 
     Unrecognized
 };
@@ -170,6 +179,7 @@ namespace {
         {OptionType::OutputFileName, L'o', L"output",  true},
         {OptionType::Format,         L'f', L"format",  true},
         {OptionType::Slice,          L's', L"slice",   true},
+        {OptionType::Threads,        L't', L"threads", true},
     };
 }
 
@@ -233,17 +243,23 @@ bool parseOptionFormat(Parameters& params, wchar_t* value) {
 //__________________________________________________________________________________________________
 
 bool parseOptionSlice (Parameters &params, wchar_t* value) {
-    // Parse the --slice option string. Format is '<start>[-<end>][x<stepSize>]'.
+    // Parse the --slice option string. Format is '<start>[-<end>][x<stepSize>]'. The start may be
+    // omitted if a step size is given, in which case the whole cube is stepped through. A lone
+    // start value selects just that slice.
 
     const auto optionValue = value;
 
-    if (!isdigit(*value)) {
+    if (*value == 'x') {
+        params.sliceStart = 0;
+    } else if (isdigit(*value)) {
+        std::tie(value, params.sliceStart) = scanInteger(value);
+        if (*value == 0)
+            params.sliceEnd = params.sliceStart;
+    } else {
         wcerr << "image4: Invalid slice start (" << optionValue << ").\n";
         return false;
     }
 
-    std::tie(value, params.sliceStart) = scanInteger(value);
-
     if (*value == '-') {
         ++value;
         if (!isdigit(*value)) {
@@ -272,6 +288,24 @@ bool parseOptionSlice (Parameters &params, wchar_t* value) {
 
 //__________________________________________________________________________________________________
 
+bool parseOptionThreads (Parameters &params, wchar_t* value) {
+    // Parse the --threads option string.
+
+    const auto optionValue = value;
+
+    if (isdigit(*value))
+        std::tie(value, params.threads) = scanInteger(value);
+
+    if (!isdigit(*optionValue) || *value) {
+        wcerr << "image4: Invalid thread count (" << optionValue << ").\n";
+        return false;
+    }
+
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
 bool processParameters (Parameters &params, int argc, wchar_t *argv[]) {
     // Process the command-line options and load results into the given Parameters object. Returns
     // true on success, false on error.
@@ -339,6 +373,11 @@ bool processParameters (Parameters &params, int argc, wchar_t *argv[]) {
                 if (!parseOptionSlice(params, optionValue))
                     return false;
                 break;
+
+            case OptionType::Threads:
+                if (!parseOptionThreads(params, optionValue))
+                    return false;
+                break;
         }
     }
 
@@ -395,217 +434,129 @@ bool processParameters (Parameters &params, int argc, wchar_t *argv[]) {
 
 //__________________________________________________________________________________________________
 
-ifstream openImageFile(const wstring& fileName) {
-    // Opens the input image file for reading.
-
-    ifstream imageFile;
-    imageFile.open(fileName, ios::binary | ios::in);
-    return imageFile;
-}
+wstring sliceFileName(const wstring &fileName, int slice, int lastSlice, bool multipleSlices) {
+    // Returns the output file name for the given slice. The first `##` in the file name is replaced
+    // with the slice index, zero-padded to the width of the last slice index. If there is no `##`,
+    // the padded index is inserted ahead of the file extension when multiple slices are output.
 
-//__________________________________________________________________________________________________
+    auto index = to_wstring(slice);
+    index.insert(0, to_wstring(lastSlice).length() - index.length(), L'0');
 
-uint32_t readUInt32(ifstream &is) {
-    uint8_t b[4];
-    is.read(reinterpret_cast<char*>(b), sizeof(b));
-    return (static_cast<uint32_t>(b[0]) << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
-}
+    auto hashes = fileName.find(L"##");
+    if (hashes != wstring::npos)
+        return fileName.substr(0, hashes) + index + fileName.substr(hashes + 2);
 
-//__________________________________________________________________________________________________
+    if (!multipleSlices)
+        return fileName;
 
-uint16_t readUInt16(ifstream &is) {
-    uint8_t b[2];
-    is.read(reinterpret_cast<char*>(b), sizeof(b));
-    return (static_cast<uint16_t>(b[0]) << 8) | b[1];
-}
+    auto extension = fileName.rfind(L'.');
+    auto separator = fileName.find_last_of(L"/\\");
 
-//__________________________________________________________________________________________________
+    if (extension == wstring::npos || (separator != wstring::npos && extension < separator))
+        return fileName + index;
 
-uint8_t readUInt8(ifstream &is) {
-    char b;
-    is.read(&b, 1);
-    return static_cast<uint8_t>(b);
+    return fileName.substr(0, extension) + index + fileName.substr(extension);
 }
 
 //__________________________________________________________________________________________________
 
-ImageHeader readImageHeader(ifstream &imageFile, wstring imageFileName) {
-    // Reads in and returns the 3D image cube header structure. On failure, the magic field is set
-    // to zero.
-
-    ImageHeader header;
-
-    header.magic = readUInt32(imageFile);
-    if (header.magic != ray4FormatMagic) {
-        wcerr << "image4: Image file \"" << imageFileName << "\" is not a value ray4 image file.\n";
-        return { 0 };
-    }
-
-    header.version = readUInt8(imageFile);
-    if (header.version != 1) {
-        wcerr << "image4: ray4 image file \"" << imageFileName << "\" is an unsupported version ("
-              << header.version << ").\n";
-        return { 0 };
-    }
-
-    header.bitsPerPixel = readUInt8(imageFile);
-    if (header.bitsPerPixel != 24) {
-        wcerr << "image4: ray4 image file \"" << imageFileName << "\" has an unsupported bits per pixel ("
-            << header.bitsPerPixel << ").\n";
-        return { 0 };
-    }
-
-    for (auto i = 0;  i < 3;  ++i)
-        header.aspect[i] = readUInt16(imageFile);
-
-    if (header.aspect[0] != 1 || header.aspect[1] != 1 || header.aspect[2] != 1) {
-        wcerr << "image4: ray4 image file \"" << imageFileName << "\" has aspect ratio "
-              << header.aspect[0] << ':' << header.aspect[1] << ':' << header.aspect[2]
-              << ". Only 1:1:1 is supported.\n";
-        return { 0 };
-    }
-
-    for (auto i = 0;  i < 3;  ++i)
-        header.start[i] = readUInt16(imageFile);
-
-    for (auto i = 0;  i < 3;  ++i)
-        header.end[i] = readUInt16(imageFile);
-
-    if (header.end[0] < header.start[0] || header.end[1] < header.start[1] || header.end[2] < header.start[2]) {
-        wcerr << "image4: ray4 image file \"" << imageFileName << "\" has invalid start/end values.\n";
-        return { 0 };
-    }
-
-    return header;
-}
-
-//__________________________________________________________________________________________________
-
-bool outputImageSliceBinaryPPM (
-    const char       *planeBuff,
-    const Parameters &params,
-    int               resolution[3])
+bool generateImageSlices(const ImageCube &imageCube, const Parameters &params)
 {
-    // Write the image plane to the output file in the binary PPM format.
-    // See https://en.wikipedia.org/wiki/Netpbm.
+    // Generate the image slices requested by the user. Each slice is written to its own output
+    // image file, and slices are encoded in parallel on a thread pool.
 
-    ofstream outputImage;
-    outputImage.open(params.outputFileName, ios::binary | ios::out);
-    if (!outputImage.good()) {
-        wcerr << "image4: Open failed for output image file \"" << params.outputFileName << "\".\n";
+    if (params.fileFormat != FileFormat::PPM_Binary && params.fileFormat != FileFormat::PPM_ASCII) {
+        wcerr << "image4: Unsupported output file format.\n";
         return false;
     }
 
-    // ASCII PPM File Header
-
-    outputImage << "P6\n" << resolution[0] << ' ' << resolution[1] << '\n' << "255\n";
-
-    // ASCII PPM Image Data
+    const int depth    = imageCube.depth();
+    const int sliceEnd = (params.sliceEnd < 0) ? depth - 1 : params.sliceEnd;
 
-    const int pixelsPerPlane = resolution[0] * resolution[1];
-    const uint8_t *color = reinterpret_cast<const uint8_t*>(planeBuff);
-    for (auto i = 0; i < pixelsPerPlane; ++i)
-        outputImage << *color++ << *color++ << *color++;
-
-    outputImage.close();
-    return true;
-}
-
-//__________________________________________________________________________________________________
-
-bool outputImageSliceAsciiPPM (
-    const char       *planeBuff,
-    const Parameters &params,
-    int               resolution[3])
-{
-    // Write the image plane to the output file in the ASCII PPM format.
-    // See https://en.wikipedia.org/wiki/Netpbm.
-
-    ofstream outputImage;
-    outputImage.open(params.outputFileName, ios::binary | ios::out);
-    if (!outputImage.good()) {
-        wcerr << "image4: Open failed for output image file \"" << params.outputFileName << "\".\n";
+    if (depth <= params.sliceStart || depth <= sliceEnd) {
+        wcerr << "image4: Slice range " << params.sliceStart << '-' << sliceEnd
+              << " is outside the image cube (depth " << depth << ").\n";
         return false;
     }
 
-    // ASCII PPM File Header
-
-    outputImage << "P3\n" << resolution[0] << ' ' << resolution[1] << '\n' << "255\n";
-
-    // ASCII PPM Image Data
-    
-    const int pixelsPerPlane = resolution[0] * resolution[1];
-    const uint8_t *color = reinterpret_cast<const uint8_t*>(planeBuff);
-    for (auto i = 0; i < pixelsPerPlane; ++i)
-        outputImage << to_string(*color++) << ' ' << to_string(*color++) << ' ' << to_string(*color++) << '\n';
+    if (sliceEnd < params.sliceStart) {
+        wcerr << "image4: Slice end (" << sliceEnd << ") precedes slice start ("
+              << params.sliceStart << ").\n";
+        return false;
+    }
 
-    outputImage.close();
-    return true;
-}
+    const int sliceCount = 1 + (sliceEnd - params.sliceStart) / params.sliceStep;
+    const int lastSlice  = params.sliceStart + (sliceCount - 1) * params.sliceStep;
 
-//__________________________________________________________________________________________________
+    vector<wstring> fileNames(sliceCount);
+    for (auto i = 0;  i < sliceCount;  ++i) {
+        fileNames[i] = sliceFileName(
+            params.outputFileName, params.sliceStart + i * params.sliceStep, lastSlice, sliceCount > 1);
+    }
 
-bool generateImageSlices(ifstream & imageCubeFile, const ImageHeader & header, const Parameters & params)
-{
-    // Generate the image slices requested by the user.
-    // For now, just generate a single image slice and save it out.
+    // Never spin up more threads than there are slices to encode.
 
-    // Calculate image dimensions and allocate the plane pixel buffer.
+    int threads = params.threads;
+    if (threads == 0)
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
 
-    int resolution[3] = {
-        1 + header.end[0] - header.start[0],
-        1 + header.end[1] - header.start[1],
-        1 + header.end[2] - header.start[2]
-    };
+    WorkPool pool(std::min(threads, sliceCount));
 
-    const int bytesPerPixel  = header.bitsPerPixel / 8;
-    const int pixelsPerPlane = resolution[0] * resolution[1];
-    const int bytesPerPlane  = pixelsPerPlane * bytesPerPixel;
+    vector<char> written(sliceCount, false);  // Per-Slice Success (not vector<bool>; set in parallel)
 
-    auto planeBuff = new char[bytesPerPlane];
+    pool.run(sliceCount, [&](int i) {
+        const int slice = params.sliceStart + i * params.sliceStep;
 
-    // Seek to the start plane.
+        // Version 1 planes are read directly from the mapped file. Version 2 planes are decoded
+        // into a plane buffer.
 
-    int planeOffset = sizeof(ImageHeader) + (params.sliceStart * bytesPerPlane);
-    imageCubeFile.seekg(planeOffset);
+        vector<uint8_t> planeBuff;
+        auto planeData = imageCube.plane(slice);
 
-    // Read the image plane.
+        if (!planeData) {
+            planeBuff.resize(imageCube.planeSize());
+            imageCube.readPlane(slice, planeBuff.data());
+            planeData = planeBuff.data();
+        }
 
-    imageCubeFile.read(planeBuff, bytesPerPlane);
+        written[i] = writePPM(fileNames[i], planeData, imageCube.width(), imageCube.height(),
+                              params.fileFormat == FileFormat::PPM_ASCII);
+    });
 
-    switch (params.fileFormat) {
-        case FileFormat::PPM_Binary:
-            if (!outputImageSliceBinaryPPM(planeBuff, params, resolution))
-                return false;
-            break;
+    // Report failures after all slices are done, so messages from different threads aren't mixed.
 
-        case FileFormat::PPM_ASCII:
-            if (!outputImageSliceAsciiPPM(planeBuff, params, resolution))
-                return false;
-            break;
+    bool success = true;
 
-        default:
-            wcerr << "image4: Unsupported output file format.\n";
+    for (auto i = 0;  i < sliceCount;  ++i) {
+        if (!written[i]) {
+            wcerr << "image4: Unable to write output image file \"" << fileNames[i] << "\".\n";
+            success = false;
+        }
     }
 
-    return true;
+    return success;
 }
 
 //__________________________________________________________________________________________________
 
-void printFileInfo(const ImageHeader& header, const wstring& imageFileName) {
+void printFileInfo(const ImageCubeHeader& header, const wstring& imageFileName) {
     // Print information about the image file.
 
     wcout << "\nray4 image file \"" << imageFileName << "\":\n";
     wcout << "    Format Version: " << header.version << '\n';
     wcout << "    Bits Per Pixel: " << header.bitsPerPixel << '\n';
-    wcout << "    Aspect Ratio: " << header.aspect[0] << ':' << header.aspect[1] << ':' << header.aspect[2] << '\n';
-    wcout << "    Start Pixel: " << header.start[0] << ',' << header.start[1] << ',' << header.start[2] << '\n';
-    wcout << "    End Pixel: " << header.end[0] << ',' << header.end[1] << ',' << header.end[2] << '\n';
+
+    if (header.version == 2) {
+        wcout << "    Background Pixel: " << int(header.background[0]) << ','
+              << int(header.background[1]) << ',' << int(header.background[2]) << '\n';
+    } else {
+        wcout << "    Aspect Ratio: " << header.aspect[0] << ':' << header.aspect[1] << ':' << header.aspect[2] << '\n';
+        wcout << "    Start Pixel: " << header.start[0] << ',' << header.start[1] << ',' << header.start[2] << '\n';
+        wcout << "    End Pixel: " << header.end[0] << ',' << header.end[1] << ',' << header.end[2] << '\n';
+    }
+
     wcout << "    Effective Resolution: "
-          << (1 + header.end[0] - header.start[0]) << 'x'
-          << (1 + header.end[1] - header.start[1]) << 'x'
-          << (1 + header.end[2] - header.start[2]) << '\n';
+          << header.resolution[0] << 'x' << header.resolution[1] << 'x' << header.resolution[2] << '\n';
     wcout << '\n';
 }
 
@@ -625,24 +576,21 @@ int wmain(int argc, wchar_t *argv[]) {
         return 0;
     }
 
-    ifstream imageStream = openImageFile(params.imageFileName);
+    ImageCube imageCube;
+    string errorMessage;
 
-    if (!imageStream.good()) {
-        wcerr << "image4: Open failed for image file \"" << params.imageFileName << "\".\n";
+    if (!imageCube.open(params.imageFileName, errorMessage)) {
+        wcerr << "image4: ray4 image file \"" << params.imageFileName << "\" "
+              << wstring(errorMessage.begin(), errorMessage.end()) << ".\n";
         return 1;
     }
 
-    ImageHeader imageHeader = readImageHeader(imageStream, params.imageFileName);
-
-    if (!imageHeader.magic)
-        return 1;
-
     if (params.printFileInfo) {
-        printFileInfo(imageHeader, params.imageFileName);
+        printFileInfo(imageCube.header(), params.imageFileName);
         return 0;
     }
 
-    if (!params.outputFileName.empty() && !generateImageSlices(imageStream, imageHeader, params))
+    if (!params.outputFileName.empty() && !generateImageSlices(imageCube, params))
         return 1;
 
     return 0;
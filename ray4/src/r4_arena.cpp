@@ -0,0 +1,128 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// r4_arena.cpp
+//
+// This file contains the implementation of the Arena bump allocator. See r4_arena.h for more
+// information.
+//==================================================================================================
+
+#include "r4_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+
+
+//__________________________________________________________________________________________________
+
+void* Arena::allocate (size_t size, size_t alignment) {
+    if (size >= CACHE_LINE)
+        alignment = std::max(alignment, CACHE_LINE);
+
+    // Round the next free address up to the alignment. Blocks start on a cache-line boundary, so
+    // any alignment up to a cache line can be met in a fresh block past its header.
+
+    auto aligned = [alignment](char *p) {
+        auto address = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<char*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    };
+
+    char *block = current ? aligned(next) : nullptr;
+
+    if (!block || size > static_cast<size_t>(limit - block)) {
+        auto headerSize = (sizeof(Block) + alignment - 1) & ~(alignment - 1);
+        if (!addBlock(headerSize + size))
+            return nullptr;
+        block = aligned(next);
+    }
+
+    next  = block + size;
+    used += size;
+
+    return block;
+}
+
+//__________________________________________________________________________________________________
+
+bool Arena::addBlock (size_t minimumSize) {
+    // Adds a new block of at least the given size, which becomes the current block.
+
+    size_t size = nextSize;
+
+    if (minimumSize > size) {
+        size = (minimumSize + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+    } else {
+        nextSize = std::min(2 * nextSize, MAX_BLOCK_SIZE);
+    }
+
+    void *memory = ::operator new(size, std::align_val_t{CACHE_LINE}, std::nothrow);
+    if (!memory)
+        return false;
+
+    auto block = static_cast<Block*>(memory);
+    block->previous = current;
+    block->size     = size;
+
+    current = block;
+    next    = reinterpret_cast<char*>(block + 1);
+    limit   = reinterpret_cast<char*>(block) + size;
+
+    reserved += size;
+    ++blocks;
+
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+void Arena::release () {
+    while (current) {
+        auto previous = current->previous;
+        ::operator delete(current, std::align_val_t{CACHE_LINE});
+        current = previous;
+    }
+
+    next     = nullptr;
+    limit    = nullptr;
+    nextSize = FIRST_BLOCK_SIZE;
+    reserved = 0;
+    used     = 0;
+    blocks   = 0;
+}
+
+//__________________________________________________________________________________________________
+
+Arena::Stats Arena::stats () const {
+    // The tail of each block is only lost once a later block replaces it; the unused tail of the
+    // current block is not yet counted as padding.
+
+    Stats result;
+
+    result.reserved = reserved;
+    result.used     = used;
+    result.blocks   = blocks;
+    result.padding  = reserved - used - static_cast<size_t>(limit - next);
+
+    return result;
+}
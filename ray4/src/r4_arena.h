@@ -0,0 +1,89 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+#ifndef R4_ARENA_H
+#define R4_ARENA_H
+
+//==================================================================================================
+// r4_arena.h
+//
+// A bump allocator that holds the scene for the life of the program. Allocations are carved out of
+// large cache-line-aligned blocks, in allocation order, so that data created together lies
+// together in memory. Nothing is freed individually; the whole arena is released at once.
+//==================================================================================================
+
+#include <cstddef>
+
+
+
+//__________________________________________________________________________________________________
+
+class Arena {
+    // Each block begins with a small header linking it to the previous block. Block sizes double
+    // from FIRST_BLOCK_SIZE up to MAX_BLOCK_SIZE, so the number of blocks (and the cost of release)
+    // grows only logarithmically with the arena size. Requests too large for the current block
+    // size get a block of their own.
+
+  public:
+    static const size_t CACHE_LINE       = 64;         // Cache Line Size in Bytes
+    static const size_t FIRST_BLOCK_SIZE = 64 << 10;   // Size of the First Block
+    static const size_t MAX_BLOCK_SIZE   = 4 << 20;    // Largest Regular Block Size
+
+    struct Stats {
+        size_t reserved;  // Total Bytes of All Blocks, Including Headers
+        size_t used;      // Bytes Handed Out by allocate()
+        size_t padding;   // Bytes Lost to Alignment and Block Headers
+        size_t blocks;    // Number of Blocks
+    };
+
+    Arena() = default;
+    ~Arena() { release(); }
+
+    Arena(const Arena&) = delete;
+    Arena& operator= (const Arena&) = delete;
+
+    // Returns uninitialized memory for size bytes at the given alignment (a power of two), or null
+    // if the system is out of memory. Allocations of a cache line or more are also aligned to a
+    // cache line, so that they never span more cache lines than their size requires.
+    void* allocate (size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Frees every block, invalidating all memory handed out by the arena.
+    void release ();
+
+    Stats stats () const;
+
+  private:
+    struct Block {
+        Block  *previous;  // Previously Allocated Block
+        size_t  size;      // Block Size in Bytes, Including This Header
+    };
+
+    bool addBlock (size_t minimumSize);
+
+    Block  *current  { nullptr };  // Most Recent Block
+    char   *next     { nullptr };  // Next Free Byte of the Current Block
+    char   *limit    { nullptr };  // End of the Current Block
+    size_t  nextSize { FIRST_BLOCK_SIZE };  // Size of the Next Regular Block
+    size_t  reserved { 0 };        // Total Bytes of All Blocks
+    size_t  used     { 0 };        // Bytes Handed Out
+    size_t  blocks   { 0 };        // Number of Blocks
+};
+
+#endif
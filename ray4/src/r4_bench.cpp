@@ -0,0 +1,750 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// ray4_bench
+//
+// This tool measures the rendering performance of the `ray4` 4D ray tracer. It renders a fixed set
+// of canonical scenes from the `inputs.r4/` directory, plus synthetic scaling scenes of N random
+// spheres or tetrahedrons, and reports rays per second, intersection tests per ray and the time
+// spent in each program phase. Each scene is rendered by running `ray4` with the `--stats-json`
+// option and reading back its report.
+//
+// Results may be saved to a baseline file, and a later run may be compared against that baseline
+// to flag performance regressions. Alternatively, each scene may be rendered both in full and with
+// adaptive subdivision, to report the speedup and image error of the adaptive mode.
+//==================================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+#ifndef RAY4_BENCH_EXECUTABLE
+    #define RAY4_BENCH_EXECUTABLE "ray4"
+#endif
+
+#ifndef RAY4_BENCH_INPUTS
+    #define RAY4_BENCH_INPUTS "inputs.r4"
+#endif
+
+
+//__________________________________________________________________________________________________
+// Information Text Definitions
+
+static auto version = "ray4_bench 1.0.0 | 2026-10-17 | https://github.com/hollasch/ray4\n";
+
+static auto usage = R"(
+ray4_bench: Performance benchmark for the ray4 ray tracer
+usage:  ray4_bench [-h|--help] [-v|--version]
+                   [-e|--executable <ray4 Program>] [-i|--inputs <Scene Directory>]
+                   [-n|--runs <Run Count>] [-t|--threads <Thread Count>]
+                   [-s|--save <Results File>] [-b|--baseline <Results File>]
+                   [-T|--tolerance <Percent>]
+                   [-a|--adaptive <Cell Size>[:<Tolerance>]]
+
+This tool renders a fixed set of canonical scenes and synthetic scaling scenes
+with ray4, and reports rays per second, intersection tests per ray and the time
+of each program phase for every scene.
+
+-h, --help
+    Print usage + version information and exit.
+
+-v, --version
+    Print version information and exit.
+
+-e, --executable <ray4 Program>
+    The ray4 executable to measure. The default is the ray4 program built
+    alongside this tool.
+
+-i, --inputs <Scene Directory>
+    The directory holding the canonical scenes. The default is the inputs.r4/
+    directory of the source tree.
+
+-n, --runs <Run Count>
+    The number of times each scene is rendered. The fastest trace of these runs
+    is reported. The default is 3.
+
+-t, --threads <Thread Count>
+    The number of ray4 trace threads. The default of 1 gives the most
+    repeatable results.
+
+-s, --save <Results File>
+    Save the results to the given file, for use as a later baseline.
+
+-b, --baseline <Results File>
+    Compare the results against a previously saved results file. Any scene
+    whose rays per second drop by more than the tolerance, or whose
+    intersection tests per ray rise, is flagged as a regression, and the tool
+    exits with a non-zero status.
+
+-T, --tolerance <Percent>
+    The allowed drop in rays per second before a scene is flagged as a
+    regression. The default is 5 percent.
+
+-a, --adaptive <Cell Size>[:<Tolerance>]
+    Instead of the performance report, render every scene both in full and
+    with the given ray4 --adaptive subdivision, and compare the two. For each
+    scene, the report gives the trace times and speedup, the fraction of
+    primary rays traced, the largest and mean difference of a pixel color
+    component (0-255), the peak signal-to-noise ratio, and the percentage of
+    pixels that differ from the full trace.
+
+Examples:
+    ray4_bench --save baseline.txt
+    ray4_bench --baseline baseline.txt --runs 5
+    ray4_bench --adaptive 8:0.02
+
+)";
+
+
+//__________________________________________________________________________________________________
+// Benchmark Scenes
+
+enum class SceneSource { File, Spheres, Tetrahedrons };
+
+struct BenchScene {
+    string       name;        // Scene Name, as Reported
+    SceneSource  source;      // Origin of the Scene Description
+    int          count;       // Number of Synthetic Objects
+    const char  *resolution;  // Fixed Render Resolution
+};
+
+static const vector<BenchScene> benchScenes {
+    { "HS1.R4",       SceneSource::File,             0, "128:128:128" },
+    { "HS2.R4",       SceneSource::File,             0, "128:128:128" },
+    { "HS3.R4",       SceneSource::File,             0, "128:128:128" },
+    { "HS4.R4",       SceneSource::File,             0, "128:128:128" },
+    { "HS5.R4",       SceneSource::File,             0, "128:128:128" },
+    { "HS6.R4",       SceneSource::File,             0, "128:128:128" },
+    { "HS7.R4",       SceneSource::File,             0, "128:128:128" },
+    { "HT1.R4",       SceneSource::File,             0, "128:128:128" },
+    { "HT2.R4",       SceneSource::File,             0, "128:128:128" },
+    { "HT3.R4",       SceneSource::File,             0, "128:128:128" },
+    { "scube.r4",     SceneSource::File,             0, "128:128:128" },
+    { "tcube.r4",     SceneSource::File,             0, "128:128:128" },
+    { "dots.r4",      SceneSource::File,             0, "128:128:128" },
+    { "dots3.r4",     SceneSource::File,             0, "128:128:128" },
+    { "dots4.r4",     SceneSource::File,             0, "128:128:128" },
+    { "dots_axes.r4", SceneSource::File,             0, "128:128:128" },
+    { "spheres-100",  SceneSource::Spheres,        100, "96:96:96" },
+    { "spheres-1k",   SceneSource::Spheres,       1000, "96:96:96" },
+    { "spheres-10k",  SceneSource::Spheres,      10000, "96:96:96" },
+    { "tets-100",     SceneSource::Tetrahedrons,   100, "96:96:96" },
+    { "tets-1k",      SceneSource::Tetrahedrons,  1000, "96:96:96" },
+    { "tets-10k",     SceneSource::Tetrahedrons, 10000, "96:96:96" },
+};
+
+
+//__________________________________________________________________________________________________
+// Benchmark Results
+
+enum class Phase { Parse, Build, Grid, Trace, Write, Count };
+
+static const char *phaseKeys[] {     // Phase Names in the ray4 Statistics Report
+    "parse", "build", "grid", "trace", "write"
+};
+
+struct BenchResult {
+    string  name;                                           // Scene Name
+    double  raysPerSecond { 0 };                               // Trace Rays per Second
+    double  testsPerRay   { 0 };                               // Intersection Tests per Ray
+    double  primaryRays   { 0 };                               // Primary Rays Traced
+    double  phaseSeconds[static_cast<int>(Phase::Count)] { };  // Wall Time per Program Phase
+};
+
+
+//__________________________________________________________________________________________________
+// Program Parameters
+
+struct Parameters {
+    bool     printHelp    { false };                  // Print help + version and exit.
+    bool     printVersion { false };                  // Print version and exit.
+    string   executable   { RAY4_BENCH_EXECUTABLE };  // ray4 Program Path
+    string   inputs       { RAY4_BENCH_INPUTS };      // Canonical Scene Directory
+    int      runs         { 3 };                      // Renders per Scene
+    int      threads      { 1 };                      // ray4 Trace Threads
+    string   saveFile     { };                        // Results Output File
+    string   baselineFile { };                        // Baseline Results File
+    double   tolerance    { 5.0 };                    // Allowed Rays/Second Drop, in Percent
+    string   adaptive     { };                        // ray4 --adaptive Value (Empty -> None)
+};
+
+
+//__________________________________________________________________________________________________
+
+static bool parseInteger (const char *value, int &result, int minimum) {
+    // Parses a whole decimal integer no less than the given minimum. Returns false on failure.
+
+    char *end;
+    long number = strtol (value, &end, 10);
+
+    if (end == value || *end || number < minimum || number > 1'000'000)
+        return false;
+
+    result = static_cast<int>(number);
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+bool processParameters (Parameters &params, int argc, char *argv[]) {
+    // Reads the command-line arguments into the program parameters. Returns false on error.
+
+    for (int argi = 1;  argi < argc;  ++argi) {
+        string arg = argv[argi];
+
+        if (arg == "-h" || arg == "--help") {
+            params.printHelp = true;
+            return true;
+        }
+
+        if (arg == "-v" || arg == "--version") {
+            params.printVersion = true;
+            return true;
+        }
+
+        if (argi + 1 >= argc) {
+            fprintf (stderr, "ray4_bench: Missing value or unknown option (%s).\n", arg.c_str());
+            return false;
+        }
+
+        const char *value = argv[++argi];
+
+        if (arg == "-e" || arg == "--executable") {
+            params.executable = value;
+        } else if (arg == "-i" || arg == "--inputs") {
+            params.inputs = value;
+        } else if (arg == "-n" || arg == "--runs") {
+            if (!parseInteger (value, params.runs, 1)) {
+                fprintf (stderr, "ray4_bench: Invalid run count (%s).\n", value);
+                return false;
+            }
+        } else if (arg == "-t" || arg == "--threads") {
+            if (!parseInteger (value, params.threads, 0)) {
+                fprintf (stderr, "ray4_bench: Invalid thread count (%s).\n", value);
+                return false;
+            }
+        } else if (arg == "-s" || arg == "--save") {
+            params.saveFile = value;
+        } else if (arg == "-b" || arg == "--baseline") {
+            params.baselineFile = value;
+        } else if (arg == "-T" || arg == "--tolerance") {
+            char *end;
+            params.tolerance = strtod (value, &end);
+            if (end == value || *end || params.tolerance < 0) {
+                fprintf (stderr, "ray4_bench: Invalid tolerance (%s).\n", value);
+                return false;
+            }
+        } else if (arg == "-a" || arg == "--adaptive") {
+            params.adaptive = value;
+        } else {
+            fprintf (stderr, "ray4_bench: Unrecognized option (%s).\n", arg.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+static void writeSyntheticScene (const fs::path &fileName, SceneSource source, int count) {
+    // Writes a scene of the given number of random spheres or tetrahedrons scattered through a
+    // 4-cube in front of the camera. The random sequence is fixed, so every run and every platform
+    // renders the same scene. Random values are scaled from the raw generator output because the
+    // standard distributions may differ between library implementations.
+
+    std::mt19937 random { 1991 };
+    auto uniform = [&random](double low, double high) {
+        return low + (high - low) * (random() / 4294967296.0);
+    };
+
+    ofstream out { fileName };
+
+    out << "Ambient .3 .3 .3\n"
+           "Background .1 .1 .1\n"
+           "MaxDepth 2\n"
+           "View ( From 0 0 0 12 To 0 0 0 0 Up 0 1 0 0 Over 1 0 0 0 Angle 50 )\n"
+           "Light ( position 2 2 2 8 color [.9 .9 .9] )\n"
+           "Light ( direction -1 1 0 1 color [.4 .4 .4] )\n"
+           "Attributes A ( ambient [.2 .2 .2] diffuse [.6 .3 .3] specular [.2 .2 .2] shine 20 )\n"
+           "Attributes B ( ambient [.2 .2 .2] diffuse [.3 .6 .3] reflect 1 specular [.4 .4 .4] )\n";
+
+    // Object sizes shrink with the object count so that the scene density stays roughly constant.
+
+    const double size = 2.0 / sqrt(sqrt(static_cast<double>(count)));
+
+    char line[256];
+
+    for (int i = 0;  i < count;  ++i) {
+        const char *attributes = (i % 4) ? "A" : "B";
+        double center[4];
+
+        for (auto &coord : center)
+            coord = uniform (-3.0, 3.0);
+
+        if (source == SceneSource::Spheres) {
+            snprintf (line, sizeof(line),
+                      "Sphere ( center %.4f %.4f %.4f %.4f radius %.4f attributes %s )\n",
+                      center[0], center[1], center[2], center[3], uniform(0.5, 1.0) * size,
+                      attributes);
+            out << line;
+        } else {
+            out << "Tetrahedron ( attributes " << attributes << " vertices";
+            for (int vertex = 0;  vertex < 4;  ++vertex) {
+                for (int axis = 0;  axis < 4;  ++axis) {
+                    snprintf (line, sizeof(line), " %.4f", center[axis] + uniform(-size, size));
+                    out << line;
+                }
+            }
+            out << " )\n";
+        }
+    }
+
+    if (!out)
+        fprintf (stderr, "ray4_bench: Unable to write scene (%s).\n", fileName.string().c_str());
+}
+
+//__________________________________________________________________________________________________
+
+static double jsonNumber (const string &text, std::initializer_list<const char*> path) {
+    // Returns the number following the given sequence of keys in the ray4 statistics report. Each
+    // key is searched for after the previous one, which is sufficient for the fixed layout of that
+    // report. Returns -1 if the keys are not found.
+
+    size_t position = 0;
+
+    for (auto key : path) {
+        position = text.find('"' + string(key) + '"', position);
+        if (position == string::npos)
+            return -1;
+        position += strlen(key) + 2;
+    }
+
+    position = text.find(':', position);
+    if (position == string::npos)
+        return -1;
+
+    return strtod (text.c_str() + position + 1, nullptr);
+}
+
+//__________________________________________________________________________________________________
+
+static bool renderScene (
+    const Parameters& params, const fs::path& sceneFile, const char* resolution,
+    const string& options, const fs::path& workDir, BenchResult& result)
+{
+    // Renders the scene once with ray4, with any additional ray4 options, and reads the statistics
+    // report into the result. The image is left in bench.icube in the work directory. Returns false
+    // if ray4 fails.
+
+    const auto imageFile = workDir / "bench.icube";
+    const auto statsFile = workDir / "bench.json";
+
+    fs::remove (statsFile);
+
+    #if defined(_WIN32)
+        const char *nullDevice = "NUL";
+    #else
+        const char *nullDevice = "/dev/null";
+    #endif
+
+    std::ostringstream command;
+    command << '"' << params.executable << '"'
+            << " -t " << params.threads << " -r " << resolution
+            << " -i \"" << sceneFile.string() << '"'
+            << " -o \"" << imageFile.string() << '"'
+            << " -j \"" << statsFile.string() << '"'
+            << options
+            << " > " << nullDevice;
+
+    #if defined(_WIN32)
+        // cmd.exe strips the outer quotes from a command line that begins with a quote.
+        const string commandLine = '"' + command.str() + '"';
+    #else
+        const string commandLine = command.str();
+    #endif
+
+    if (0 != system (commandLine.c_str()))
+        return false;
+
+    ifstream in { statsFile };
+    if (!in)
+        return false;
+
+    std::stringstream contents;
+    contents << in.rdbuf();
+    const string report = contents.str();
+
+    result.raysPerSecond = jsonNumber (report, {"raysPerSecond"});
+    result.testsPerRay   = jsonNumber (report, {"testsPerRay"});
+    result.primaryRays   = jsonNumber (report, {"rays", "primary"});
+
+    for (auto phase = 0;  phase < static_cast<int>(Phase::Count);  ++phase)
+        result.phaseSeconds[phase] =
+            jsonNumber (report, {"phases", phaseKeys[phase], "wallSeconds"});
+
+    return result.raysPerSecond >= 0 && result.testsPerRay >= 0;
+}
+
+//__________________________________________________________________________________________________
+
+static bool renderBest (
+    const Parameters& params, const fs::path& sceneFile, const char* resolution,
+    const string& options, const fs::path& workDir, BenchResult& best)
+{
+    // Renders the scene the requested number of times, and keeps the run with the fastest trace,
+    // which is the least disturbed by other activity. Returns false if any render fails.
+
+    for (int run = 0;  run < params.runs;  ++run) {
+        BenchResult result;
+
+        if (!renderScene (params, sceneFile, resolution, options, workDir, result))
+            return false;
+
+        if (run == 0 || result.phaseSeconds[static_cast<int>(Phase::Trace)]
+                        < best.phaseSeconds[static_cast<int>(Phase::Trace)])
+            best = result;
+    }
+
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+static fs::path sceneFilePath (
+    const Parameters& params, const BenchScene& scene, const fs::path& workDir)
+{
+    // Returns the file of the given benchmark scene, writing it first if it is synthetic.
+
+    if (scene.source == SceneSource::File)
+        return fs::path(params.inputs) / scene.name;
+
+    const auto sceneFile = workDir / (scene.name + ".r4");
+    writeSyntheticScene (sceneFile, scene.source, scene.count);
+    return sceneFile;
+}
+
+//__________________________________________________________________________________________________
+
+struct ImageError {
+    int    maxDiff      { 0 };  // Largest Color Component Difference
+    double meanDiff     { 0 };  // Mean Color Component Difference
+    double psnr         { 0 };  // Peak Signal-to-Noise Ratio in Decibels (Infinite if Identical)
+    double pixelsDiffer { 0 };  // Percentage of Pixels That Differ
+};
+
+static bool compareImages (
+    const fs::path& fileA, const fs::path& fileB, const char* resolution, ImageError& error)
+{
+    // Compares two 24-bit image cubes of the given resolution, written with the same options. The
+    // pixels are the trailing bytes of each file, after the identical headers. Returns false if
+    // either file can't be read or is too small.
+
+    size_t pixelCount = 1;
+    for (const char *field = resolution;  field;  field = strchr(field, ':')) {
+        if (*field == ':')
+            ++field;
+        pixelCount *= strtoul (field, nullptr, 10);
+    }
+
+    const size_t pixelBytes = 3 * pixelCount;
+
+    auto readPixels = [pixelBytes](const fs::path& fileName, vector<uint8_t>& pixels) {
+        std::error_code error;
+        const auto size = fs::file_size (fileName, error);
+        if (error || size < pixelBytes)
+            return false;
+
+        ifstream in { fileName, std::ios::binary };
+        in.seekg (static_cast<std::streamoff>(size - pixelBytes));
+        pixels.resize (pixelBytes);
+        in.read (reinterpret_cast<char*>(pixels.data()), static_cast<std::streamsize>(pixelBytes));
+        return static_cast<bool>(in);
+    };
+
+    vector<uint8_t> a, b;
+    if (!readPixels (fileA, a) || !readPixels (fileB, b))
+        return false;
+
+    double sum = 0, sumSquares = 0;
+    size_t differ = 0;
+
+    error.maxDiff = 0;
+
+    for (size_t i = 0;  i < pixelBytes;  i += 3) {
+        bool pixelDiffers = false;
+
+        for (size_t c = i;  c < i + 3;  ++c) {
+            const int diff = abs (a[c] - b[c]);
+            error.maxDiff = std::max (error.maxDiff, diff);
+            sum        += diff;
+            sumSquares += diff * diff;
+            pixelDiffers |= (diff != 0);
+        }
+
+        if (pixelDiffers)
+            ++differ;
+    }
+
+    const double meanSquare = sumSquares / pixelBytes;
+
+    error.meanDiff     = sum / pixelBytes;
+    error.psnr         = (meanSquare > 0) ? 10 * log10 (255.0 * 255.0 / meanSquare) : INFINITY;
+    error.pixelsDiffer = 100.0 * differ / pixelCount;
+
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+static int compareAdaptive (const Parameters& params, const fs::path& workDir) {
+    // Renders every scene both in full and with adaptive subdivision, and reports the speedup and
+    // image error of the adaptive render. Returns the number of scenes that failed to render.
+
+    printf ("Adaptive subdivision %s against the full trace:\n\n", params.adaptive.c_str());
+    printf ("%-14s %9s %9s %8s %8s %7s %8s %8s %8s\n", "Scene", "Full", "Adaptive", "Speedup",
+            "Primary", "MaxDiff", "MeanDiff", "PSNR", "Differ");
+
+    const string adaptiveOption = " -A \"" + params.adaptive + '"';
+    const auto   fullImage      = workDir / "full.icube";
+    const auto   image          = workDir / "bench.icube";
+    const int    trace          = static_cast<int>(Phase::Trace);
+
+    int failures = 0;
+
+    for (const auto &scene : benchScenes) {
+        const auto sceneFile = sceneFilePath (params, scene, workDir);
+
+        BenchResult full, adaptive;
+        ImageError  error;
+        std::error_code fileError;
+
+        bool rendered = renderBest (params, sceneFile, scene.resolution, "", workDir, full);
+
+        if (rendered)
+            fs::rename (image, fullImage, fileError);
+
+        rendered = rendered && !fileError
+                && renderBest (params, sceneFile, scene.resolution, adaptiveOption, workDir,
+                               adaptive)
+                && compareImages (fullImage, image, scene.resolution, error);
+
+        if (!rendered) {
+            printf ("%-14s  render failed\n", scene.name.c_str());
+            ++failures;
+            continue;
+        }
+
+        printf ("%-14s %8.4fs %8.4fs %7.2fx %7.1f%% %7d %8.4f %6.1fdB %7.2f%%\n",
+                scene.name.c_str(), full.phaseSeconds[trace], adaptive.phaseSeconds[trace],
+                full.phaseSeconds[trace] / adaptive.phaseSeconds[trace],
+                100.0 * adaptive.primaryRays / full.primaryRays,
+                error.maxDiff, error.meanDiff, error.psnr, error.pixelsDiffer);
+    }
+
+    return failures;
+}
+
+//__________________________________________________________________________________________________
+
+static bool saveResults (const string &fileName, const vector<BenchResult> &results) {
+    // Writes the results as one line per scene: the scene name, rays per second, tests per ray,
+    // and the wall time of each phase. Returns false on failure.
+
+    ofstream out { fileName };
+    char line[256];
+
+    out << "# ray4_bench results: scene raysPerSecond testsPerRay parse build grid trace write\n";
+
+    for (const auto &result : results) {
+        snprintf (line, sizeof(line), "%s %.1f %.4f %.6f %.6f %.6f %.6f %.6f\n",
+                  result.name.c_str(), result.raysPerSecond, result.testsPerRay,
+                  result.phaseSeconds[0], result.phaseSeconds[1], result.phaseSeconds[2],
+                  result.phaseSeconds[3], result.phaseSeconds[4]);
+        out << line;
+    }
+
+    return static_cast<bool>(out);
+}
+
+//__________________________________________________________________________________________________
+
+static bool loadResults (const string &fileName, map<string, BenchResult> &results) {
+    // Reads results written by saveResults, keyed by scene name. Returns false on failure.
+
+    ifstream in { fileName };
+    if (!in)
+        return false;
+
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields { line };
+        BenchResult result;
+
+        fields >> result.name >> result.raysPerSecond >> result.testsPerRay;
+        for (auto &seconds : result.phaseSeconds)
+            fields >> seconds;
+
+        if (fields.fail())
+            return false;
+
+        results[result.name] = result;
+    }
+
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+int main (int argc, char *argv[]) {
+    // The following is the entry procedure for the ray4 benchmark.
+
+    Parameters params;
+
+    if (!processParameters (params, argc, argv))
+        return 1;
+
+    if (params.printHelp) {
+        fputs (usage, stdout);
+        fputs (version, stdout);
+        return 0;
+    }
+
+    if (params.printVersion) {
+        fputs (version, stdout);
+        return 0;
+    }
+
+    if (!params.adaptive.empty() && (!params.saveFile.empty() || !params.baselineFile.empty())) {
+        fprintf (stderr, "ray4_bench: The adaptive comparison can't be saved or compared to a "
+                         "baseline.\n");
+        return 1;
+    }
+
+    map<string, BenchResult> baseline;  // Baseline Results by Scene Name
+
+    if (!params.baselineFile.empty() && !loadResults (params.baselineFile, baseline)) {
+        fprintf (stderr, "ray4_bench: Unable to read baseline (%s).\n",
+                 params.baselineFile.c_str());
+        return 1;
+    }
+
+    std::error_code error;
+    const auto workDir = fs::temp_directory_path(error) / "ray4_bench";
+    fs::create_directories (workDir, error);
+    if (error) {
+        fprintf (stderr, "ray4_bench: Unable to create work directory (%s).\n",
+                 workDir.string().c_str());
+        return 1;
+    }
+
+    if (!params.adaptive.empty()) {
+        const int failures = compareAdaptive (params, workDir);
+
+        fs::remove_all (workDir, error);
+
+        if (failures)
+            printf ("\n%d scene(s) failed to render.\n", failures);
+
+        return failures ? 1 : 0;
+    }
+
+    printf ("%-14s %14s %12s %10s %10s %10s %10s",
+            "Scene", "Rays/sec", "Tests/ray", "Parse", "Build", "Trace", "Write");
+    printf ((baseline.empty()) ? "\n" : " %10s\n", "vs Base");
+
+    vector<BenchResult> results;
+    int regressions = 0;
+    int failures    = 0;
+
+    for (const auto &scene : benchScenes) {
+        const auto sceneFile = sceneFilePath (params, scene, workDir);
+
+        BenchResult best;
+
+        if (!renderBest (params, sceneFile, scene.resolution, "", workDir, best)) {
+            printf ("%-14s  render failed\n", scene.name.c_str());
+            ++failures;
+            continue;
+        }
+
+        best.name = scene.name;
+        results.push_back (best);
+
+        printf ("%-14s %14.0f %12.2f %9.4fs %9.4fs %9.4fs %9.4fs",
+                best.name.c_str(), best.raysPerSecond, best.testsPerRay,
+                best.phaseSeconds[static_cast<int>(Phase::Parse)],
+                best.phaseSeconds[static_cast<int>(Phase::Build)],
+                best.phaseSeconds[static_cast<int>(Phase::Trace)],
+                best.phaseSeconds[static_cast<int>(Phase::Write)]);
+
+        // Rays per second are flagged beyond the tolerance. Tests per ray are deterministic, so
+        // any increase beyond rounding is flagged.
+
+        auto base = baseline.find(best.name);
+
+        if (base == baseline.end()) {
+            printf (baseline.empty() ? "\n" : " %10s\n", "(new)");
+        } else {
+            double change = 100.0 * (best.raysPerSecond / base->second.raysPerSecond - 1.0);
+            bool   slower = change < -params.tolerance;
+            bool   moreTests = best.testsPerRay > base->second.testsPerRay * 1.001 + 0.0001;
+
+            printf (" %+9.1f%%%s%s\n", change,
+                    slower ? "  REGRESSION: rays/sec" : "",
+                    moreTests ? "  REGRESSION: tests/ray" : "");
+
+            if (slower || moreTests)
+                ++regressions;
+        }
+    }
+
+    fs::remove_all (workDir, error);
+
+    if (!params.saveFile.empty() && !saveResults (params.saveFile, results)) {
+        fprintf (stderr, "ray4_bench: Unable to write results (%s).\n", params.saveFile.c_str());
+        return 1;
+    }
+
+    if (failures)
+        printf ("\n%d scene(s) failed to render.\n", failures);
+
+    if (!baseline.empty())
+        printf ("\n%d regression(s) against %s.\n", regressions, params.baselineFile.c_str());
+
+    return (failures || regressions) ? 1 : 0;
+}
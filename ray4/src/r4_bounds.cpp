@@ -0,0 +1,190 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// r4_bounds.cpp
+//
+// This file contains utility routines for 4D axis-aligned bounding boxes. See the header in
+// r4_main.cpp for more information on Ray4.
+//==================================================================================================
+
+#include "r4_bounds.h"
+
+#include <cmath>
+#include <limits>
+
+
+
+//__________________________________________________________________________________________________
+
+Bounds4 Bounds4::empty () {
+    const auto inf = std::numeric_limits<double>::infinity();
+    return { Point4(inf, inf, inf, inf), Point4(-inf, -inf, -inf, -inf) };
+}
+
+//__________________________________________________________________________________________________
+
+Bounds4 Bounds4::infinite () {
+    const auto inf = std::numeric_limits<double>::infinity();
+    return { Point4(-inf, -inf, -inf, -inf), Point4(inf, inf, inf, inf) };
+}
+
+//__________________________________________________________________________________________________
+
+bool Bounds4::operator== (const Bounds4& other) const {
+    return min == other.min && max == other.max;
+}
+
+//__________________________________________________________________________________________________
+
+bool Bounds4::operator!= (const Bounds4& other) const {
+    return !(*this == other);
+}
+
+//__________________________________________________________________________________________________
+
+bool Bounds4::isEmpty () const {
+    return max.x < min.x || max.y < min.y || max.z < min.z || max.w < min.w;
+}
+
+//__________________________________________________________________________________________________
+
+bool Bounds4::isFinite () const {
+    for (auto axis = 0;  axis < 4;  ++axis) {
+        if (!std::isfinite(min[axis]) || !std::isfinite(max[axis]))
+            return false;
+    }
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+void Bounds4::include (const Point4& p) {
+    for (auto axis = 0;  axis < 4;  ++axis) {
+        if (p[axis] < min[axis]) min[axis] = p[axis];
+        if (p[axis] > max[axis]) max[axis] = p[axis];
+    }
+}
+
+//__________________________________________________________________________________________________
+
+void Bounds4::include (const Bounds4& other) {
+    for (auto axis = 0;  axis < 4;  ++axis) {
+        if (other.min[axis] < min[axis]) min[axis] = other.min[axis];
+        if (other.max[axis] > max[axis]) max[axis] = other.max[axis];
+    }
+}
+
+//__________________________________________________________________________________________________
+
+void Bounds4::pad (double margin) {
+    const Vector4 offset { margin, margin, margin, margin };
+    min -= offset;
+    max += offset;
+}
+
+//__________________________________________________________________________________________________
+
+Point4 Bounds4::center () const {
+    return min + (max - min) / 2;
+}
+
+//__________________________________________________________________________________________________
+
+Vector4 Bounds4::extent () const {
+    return max - min;
+}
+
+//__________________________________________________________________________________________________
+
+int Bounds4::majorAxis () const {
+    auto size = extent();
+    int axis = 0;
+    for (auto i = 1;  i < 4;  ++i) {
+        if (size[i] > size[axis])
+            axis = i;
+    }
+    return axis;
+}
+
+//__________________________________________________________________________________________________
+
+double Bounds4::surfaceMeasure () const {
+    if (isEmpty())
+        return 0.0;
+
+    auto e = extent();
+    return 2.0 * ((e.x * e.y * e.z) + (e.x * e.y * e.w) + (e.x * e.z * e.w) + (e.y * e.z * e.w));
+}
+
+//__________________________________________________________________________________________________
+
+static bool ClipSlab (
+    double  min,     // Slab Minimum
+    double  max,     // Slab Maximum
+    double  origin,  // Ray Origin Component
+    double  invDir,  // Reciprocal of Ray Direction Component
+    double &tmin,    // Ray Parameter Interval, Clipped to the Slab
+    double &tmax)
+{
+    // Clips the ray parameter interval to a single slab of the box, returning false if the
+    // interval becomes empty. Where the ray direction component is zero, the reciprocal is infinite
+    // and the slab distances are either infinite (the ray misses or spans the slab) or not-a-number
+    // (the ray origin lies exactly on the slab boundary). The comparisons below are written so that
+    // not-a-number values leave the interval unchanged.
+
+    double tnear = (min - origin) * invDir;
+    double tfar  = (max - origin) * invDir;
+
+    if (invDir < 0.0) {
+        double temp = tnear;
+        tnear = tfar;
+        tfar  = temp;
+    }
+
+    if (tnear > tmin) tmin = tnear;
+    if (tfar  < tmax) tmax = tfar;
+
+    return tmin <= tmax;
+}
+
+//__________________________________________________________________________________________________
+
+bool Bounds4::hit (const Ray4& ray, const Vector4& invDir, double tmin, double tmax) const {
+    // This is the slab test, extended to four dimensions. The components are named explicitly
+    // rather than indexed, since this is the innermost loop of the hierarchy traversal.
+
+    return ClipSlab(min.x, max.x, ray.origin.x, invDir.x, tmin, tmax)
+        && ClipSlab(min.y, max.y, ray.origin.y, invDir.y, tmin, tmax)
+        && ClipSlab(min.z, max.z, ray.origin.z, invDir.z, tmin, tmax)
+        && ClipSlab(min.w, max.w, ray.origin.w, invDir.w, tmin, tmax);
+}
+
+//__________________________________________________________________________________________________
+
+bool Bounds4::clip (const Ray4& ray, const Vector4& invDir, double& tmin, double& tmax) const {
+    // As for hit(), but also narrows the ray parameter range to the part inside the box.
+
+    return ClipSlab(min.x, max.x, ray.origin.x, invDir.x, tmin, tmax)
+        && ClipSlab(min.y, max.y, ray.origin.y, invDir.y, tmin, tmax)
+        && ClipSlab(min.z, max.z, ray.origin.z, invDir.z, tmin, tmax)
+        && ClipSlab(min.w, max.w, ray.origin.w, invDir.w, tmin, tmax);
+}
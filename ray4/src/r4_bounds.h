@@ -0,0 +1,84 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+#ifndef R4_BOUNDS_H
+#define R4_BOUNDS_H
+
+#include "r4_point.h"
+#include "r4_ray.h"
+#include "r4_vector.h"
+
+
+
+//__________________________________________________________________________________________________
+
+class Bounds4 {
+    // An axis-aligned bounding box in four-space.
+
+  public:
+    Point4 min, max;
+
+    Bounds4() = default;
+    Bounds4(const Bounds4&) = default;
+    ~Bounds4() = default;
+    Bounds4& operator= (const Bounds4 &other) = default;
+
+    Bounds4(const Point4& point) : min(point), max(point) {}
+    Bounds4(const Point4& min, const Point4& max) : min(min), max(max) {}
+
+    // Returns an empty box, which may be grown with include().
+    static Bounds4 empty();
+
+    // Returns a box that spans all of four-space.
+    static Bounds4 infinite();
+
+    bool operator== (const Bounds4& other) const;
+    bool operator!= (const Bounds4& other) const;
+
+    bool isEmpty() const;
+    bool isFinite() const;
+
+    // Grow the box to include the given point or box.
+    void include(const Point4&);
+    void include(const Bounds4&);
+
+    // Grow the box by the given margin on all sides.
+    void pad(double margin);
+
+    Point4  center() const;
+    Vector4 extent() const;
+
+    // Returns the axis (0-3) along which the box is longest.
+    int majorAxis() const;
+
+    // Returns the 3D measure of the box boundary, the 4D analog of surface area. For a box with
+    // extents a, b, c and d this is 2(abc + abd + acd + bcd). The chance that a random ray hits a
+    // convex body is proportional to this value.
+    double surfaceMeasure() const;
+
+    // Returns true if the ray passes through the box anywhere in the ray parameter range
+    // [tmin, tmax]. The invDir vector must hold the reciprocals of the ray direction components.
+    bool hit(const Ray4& ray, const Vector4& invDir, double tmin, double tmax) const;
+
+    // As for hit(), but on success also clips [tmin, tmax] to the part of the ray inside the box.
+    bool clip(const Ray4& ray, const Vector4& invDir, double& tmin, double& tmax) const;
+};
+
+#endif
@@ -0,0 +1,686 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// r4_bvh.cpp
+//
+// This file contains the bounding volume hierarchy (BVH) over the scene objects. The hierarchy is a
+// binary tree of 4D axis-aligned bounding boxes, built after the scene is parsed with the surface
+// area heuristic (SAH), and is used for both nearest-intersection and shadow queries. Objects
+// without finite bounds (triangles) are kept outside the hierarchy and tested against every ray.
+//
+// Building the hierarchy also compiles the scene: the bounded primitives are packed by type into
+// structure-of-arrays form, in leaf order, so that each leaf covers a contiguous run of packed
+// spheres and a contiguous run of packed tetrahedrons/parallelepipeds. The leaves test these runs
+// with the type-specific loops in r4_hit.cpp, rather than through the object function pointers.
+// The primitives are packed in the render precision (see `--precision`); the hierarchy itself and
+// all other objects stay in double precision.
+// See the r4_main.cpp header comment for more information on Ray4.
+//==================================================================================================
+
+#include "ray4.h"
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+
+// Constant Definitions
+
+const int    BVH_BINS       = 16;     // Number of SAH Bins per Split
+const int    BVH_LEAF_SIZE  = 4;      // Preferred Maximum Objects per Leaf
+const int    BVH_SAH_DEPTH  = 64;     // Maximum Tree Depth for SAH Splits
+const int    BVH_STACK_SIZE = 128;    // Traversal Stack Depth
+const double BVH_TRAV_COST  = 1.0;    // SAH Relative Cost of a Node Traversal
+const double BVH_HIT_COST   = 2.0;    // SAH Relative Cost of an Object Intersection Test
+const double BVH_PAD        = 1e-9;   // Relative Box Padding, Guards Against Roundoff
+const double BVH_UNIT_TOL   = 1e-9;   // Tolerance for Unit-Length Ray Directions
+
+
+struct BVHNode {
+    Bounds4  bounds;       // Bounds of Everything Below This Node
+    uint32_t index;        // Leaf: First Packed Sphere Index; Interior: Second Child Node Index
+    uint32_t tetparIndex;  // Leaf: First Packed Tetrahedron/Parallelepiped Index
+    uint16_t sphereCount;  // Number of Leaf Spheres
+    uint16_t tetparCount;  // Number of Leaf Tetrahedrons/Parallelepipeds
+    uint8_t  axis;         // Interior Node Split Axis
+
+    // The first child of an interior node always immediately follows its parent. Interior nodes
+    // have no spheres and no tetrahedrons/parallelepipeds.
+
+    bool isLeaf () const { return (sphereCount + tetparCount) > 0; }
+};
+
+template<typename Real>
+struct PackedPrimitives {
+    SphereArraysT<Real> spheres;  // Packed Spheres
+    TetParArraysT<Real> tetpars;  // Packed Tetrahedrons/Parallelepipeds
+};
+
+struct BuildItem {
+    const ObjInfo *object;  // Scene Object
+    Bounds4        bounds;  // Object Bounds
+    Point4         center;  // Object Bounds Center
+};
+
+
+// File-Global Variables
+
+static std::vector<BVHNode>        nodes;      // Hierarchy Nodes; Node Zero Is the Root
+static PackedPrimitives<double>     packed;     // Double-Precision Primitives, In Leaf Order
+static PackedPrimitives<float>      packedf;    // Single-Precision Primitives, In Leaf Order
+static std::vector<const ObjInfo*> unbounded;  // Unbounded or Unpacked Objects
+
+
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+static void PackLeaf (
+    PackedPrimitives<Real>       &primitives,  // Packed Primitives
+    const std::vector<BuildItem> &items,       // Items to Pack
+    int                           first,       // First Item of the Leaf
+    int                           limit,       // One Past the Last Item of the Leaf
+    BVHNode                      &leaf)        // Leaf Node
+{
+    // Appends the leaf items to the packed primitives, and records their runs in the leaf node.
+
+    auto &spheres = primitives.spheres;
+    auto &tetpars = primitives.tetpars;
+
+    leaf.index       = spheres.size();
+    leaf.tetparIndex = tetpars.size();
+    leaf.axis        = 0;
+
+    for (auto i = first;  i < limit;  ++i) {
+        if (items[i].object->type == ObjType::Sphere)
+            spheres.add(items[i].object);
+        else
+            tetpars.add(items[i].object);
+    }
+
+    leaf.sphereCount = static_cast<uint16_t>(spheres.size() - leaf.index);
+    leaf.tetparCount = static_cast<uint16_t>(tetpars.size() - leaf.tetparIndex);
+}
+
+//__________________________________________________________________________________________________
+
+static uint32_t BuildNode (std::vector<BuildItem> &items, int first, int limit, int depth) {
+    // This routine builds the subtree for items [first, limit) and returns its node index. Beyond
+    // a depth of BVH_SAH_DEPTH, items are split at the median so that the tree depth stays bounded
+    // for the traversal stack.
+
+    auto nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    Bounds4 bounds       = Bounds4::empty();  // Bounds of All Items
+    Bounds4 centerBounds = Bounds4::empty();  // Bounds of All Item Centers
+
+    for (auto i = first;  i < limit;  ++i) {
+        bounds.include(items[i].bounds);
+        centerBounds.include(items[i].center);
+    }
+
+    nodes[nodeIndex].bounds = bounds;
+
+    const int count = limit - first;
+    const int axis  = centerBounds.majorAxis();
+    const double axisMin  = centerBounds.min[axis];
+    const double axisSpan = centerBounds.max[axis] - axisMin;
+
+    // Find the best split plane along the major axis of the item centers by binning the centers and
+    // evaluating the surface area heuristic at each bin boundary.
+
+    int    bestSplit = -1;                                  // Best Split Bin Boundary
+    double bestCost  = std::numeric_limits<double>::max();  // Cost of Best Split
+
+    if (count > 1 && axisSpan > 0.0 && depth < BVH_SAH_DEPTH) {
+        struct Bin {
+            Bounds4 bounds = Bounds4::empty();
+            int     count  = 0;
+        } bins[BVH_BINS];
+
+        auto binOf = [&](const BuildItem &item) {
+            int bin = static_cast<int>(BVH_BINS * (item.center[axis] - axisMin) / axisSpan);
+            return std::min(bin, BVH_BINS - 1);
+        };
+
+        for (auto i = first;  i < limit;  ++i) {
+            auto &bin = bins[binOf(items[i])];
+            bin.bounds.include(items[i].bounds);
+            ++bin.count;
+        }
+
+        // Sweep from the right to gather the bounds and counts of every right-hand partition, then
+        // sweep from the left to evaluate each split.
+
+        double rightMeasure[BVH_BINS];
+        int    rightCount[BVH_BINS];
+        {
+            Bounds4 right = Bounds4::empty();
+            int     n     = 0;
+            for (auto b = BVH_BINS - 1;  b > 0;  --b) {
+                right.include(bins[b].bounds);
+                n += bins[b].count;
+                rightMeasure[b] = right.surfaceMeasure();
+                rightCount[b]   = n;
+            }
+        }
+
+        const double parentMeasure = bounds.surfaceMeasure();
+
+        Bounds4 left = Bounds4::empty();
+        int     n    = 0;
+        for (auto b = 1;  b < BVH_BINS;  ++b) {
+            left.include(bins[b-1].bounds);
+            n += bins[b-1].count;
+
+            if (n == 0 || rightCount[b] == 0)
+                continue;
+
+            // For degenerate (flat) parent bounds, fall back to balancing the item counts.
+
+            double cost = (parentMeasure > 0.0)
+                ? (left.surfaceMeasure() * n + rightMeasure[b] * rightCount[b]) / parentMeasure
+                : static_cast<double>(std::max(n, rightCount[b]));
+
+            cost = BVH_TRAV_COST + BVH_HIT_COST * cost;
+
+            if (cost < bestCost) {
+                bestCost  = cost;
+                bestSplit = b;
+            }
+        }
+
+        // Don't split if testing every item in a single leaf is cheaper, unless the leaf would be
+        // too large.
+
+        if (bestSplit >= 0 && count <= BVH_LEAF_SIZE && bestCost >= BVH_HIT_COST * count)
+            bestSplit = -1;
+    }
+
+    // Partition the items about the chosen split. If there's no good split but there are too many
+    // items for a leaf, split them in half about the median center.
+
+    int middle = -1;
+
+    if (bestSplit >= 0) {
+        auto mid = std::partition(items.begin() + first, items.begin() + limit,
+            [&](const BuildItem &item) {
+                int bin = static_cast<int>(BVH_BINS * (item.center[axis] - axisMin) / axisSpan);
+                return std::min(bin, BVH_BINS - 1) < bestSplit;
+            });
+        middle = static_cast<int>(mid - items.begin());
+    } else if (count > BVH_LEAF_SIZE) {
+        middle = first + count / 2;
+        std::nth_element(items.begin() + first, items.begin() + middle, items.begin() + limit,
+            [axis](const BuildItem &a, const BuildItem &b) { return a.center[axis] < b.center[axis]; });
+    }
+
+    if (middle <= first || middle >= limit) {
+        if (precision == Precision::Float)
+            PackLeaf (packedf, items, first, limit, nodes[nodeIndex]);
+        else
+            PackLeaf (packed, items, first, limit, nodes[nodeIndex]);
+        return nodeIndex;
+    }
+
+    BuildNode (items, first, middle, depth + 1);
+    auto second = BuildNode (items, middle, limit, depth + 1);
+
+    nodes[nodeIndex].index       = second;
+    nodes[nodeIndex].tetparIndex = 0;
+    nodes[nodeIndex].sphereCount = 0;
+    nodes[nodeIndex].tetparCount = 0;
+    nodes[nodeIndex].axis        = static_cast<uint8_t>(axis);
+
+    return nodeIndex;
+}
+
+//__________________________________________________________________________________________________
+
+void BuildBVH () {
+    // This routine builds the bounding volume hierarchy over all objects in the object list, and
+    // packs the bounded primitives in leaf order. It must be called after the scene has been
+    // parsed, and before any rays are traced.
+
+    std::vector<BuildItem> items;
+
+    nodes.clear();
+    packed  = PackedPrimitives<double>{};
+    packedf = PackedPrimitives<float>{};
+    unbounded.clear();
+
+    for (auto optr = objlist;  optr;  optr = optr->next) {
+        // Only spheres, tetrahedrons and parallelepipeds have packed forms; any other object is
+        // tested individually, as are objects without finite bounds.
+
+        const bool packable = (optr->type == ObjType::Sphere)
+                           || (optr->type == ObjType::Tetrahedron)
+                           || (optr->type == ObjType::Parallelepiped);
+
+        if (!packable || !optr->bounds.isFinite()) {
+            unbounded.push_back(optr);
+            continue;
+        }
+
+        BuildItem item { optr, optr->bounds, optr->bounds.center() };
+
+        // Pad the bounds slightly so that roundoff in the box test never culls a ray that the
+        // object's own intersection routine would accept.
+
+        auto size = item.bounds.extent();
+        auto largest = std::max({ fabs(item.bounds.min.x), fabs(item.bounds.min.y),
+                                  fabs(item.bounds.min.z), fabs(item.bounds.min.w),
+                                  fabs(item.bounds.max.x), fabs(item.bounds.max.y),
+                                  fabs(item.bounds.max.z), fabs(item.bounds.max.w),
+                                  size.x, size.y, size.z, size.w });
+        item.bounds.pad(BVH_PAD * largest + epsilon);
+
+        items.push_back(item);
+    }
+
+    if (items.empty())
+        return;
+
+    nodes.reserve(2 * items.size());
+
+    BuildNode (items, 0, static_cast<int>(items.size()), 0);
+}
+
+//__________________________________________________________________________________________________
+
+static Vector4 Reciprocal (const Vector4 &v) {
+    return { 1.0 / v.x, 1.0 / v.y, 1.0 / v.z, 1.0 / v.w };
+}
+
+//__________________________________________________________________________________________________
+
+static bool IsCullable (const Ray4 &ray) {
+    // Returns true if the hierarchy may be used to cull objects for the given ray. The sphere
+    // intersection function assumes a unit-length ray direction, which doesn't hold for rays
+    // reflected off triangles (whose normals aren't normalized) or for refracted rays. For such
+    // rays the reported intersection need not lie within the sphere's bounds, so to render the same
+    // image they are tested against every object instead.
+
+    return !nodes.empty() && (fabs(ray.direction.normSquared() - 1.0) <= BVH_UNIT_TOL);
+}
+
+//__________________________________________________________________________________________________
+
+static void NearestUnpacked (
+    const std::vector<const ObjInfo*> &objects,        // Objects to Test
+    const Ray4                        &ray,            // Trace Ray
+    double                            &nearestT,       // Nearest Intersection Distance (-1 -> None)
+    const ObjInfo*                    &nearestObject)  // Nearest Object So Far
+{
+    // Tests each of the objects through its own (double-precision) intersection function. This is
+    // used in place of the single-precision packed loops for rays that aren't unit length, since
+    // MINDIST is measured in units of the ray parameter, and the scaled single-precision MINDIST
+    // would reject near intersections along rays with long direction vectors.
+
+    HitRecord hit;  // Nearest Intersection
+    hit.t      = nearestT;
+    hit.object = nearestObject;
+
+    for (auto object : objects)
+        (*object->intersect)(object, ray, hit);
+
+    nearestT      = hit.t;
+    nearestObject = hit.object;
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+static void NearestPacked (
+    const PackedPrimitives<Real> &primitives,     // Packed Primitives
+    const Ray4                   &ray,            // Trace Ray
+    double                       &nearestT,       // Nearest Intersection Distance (-1 -> None)
+    const ObjInfo*               &nearestObject)  // Nearest Object So Far
+{
+    // This routine finds the nearest intersection of the ray with the packed primitives, walking
+    // the hierarchy if the ray may be culled by it.
+
+    const auto &spheres = primitives.spheres;
+    const auto &tetpars = primitives.tetpars;
+    const Ray4T<Real> packedRay { ray };  // Trace Ray in Packed Precision
+
+    if (!IsCullable(ray)) {
+        if constexpr (std::is_same_v<Real, float>) {
+            NearestUnpacked (spheres.object, ray, nearestT, nearestObject);
+            NearestUnpacked (tetpars.object, ray, nearestT, nearestObject);
+        } else {
+            NearestSpheres (spheres, 0, spheres.size(), packedRay, nearestT, nearestObject);
+            NearestTetPars (tetpars, 0, tetpars.size(), packedRay, nearestT, nearestObject);
+        }
+        return;
+    }
+
+    const auto invDir = Reciprocal(ray.direction);
+
+    uint32_t stack[BVH_STACK_SIZE];  // Pending Node Stack
+    int      top = 0;                // Stack Size
+
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const auto &node = nodes[stack[--top]];
+        const auto tmax  = (nearestT > 0) ? nearestT : std::numeric_limits<double>::infinity();
+
+        if (!node.bounds.hit(ray, invDir, 0.0, tmax))
+            continue;
+
+        if (node.isLeaf()) {
+            NearestSpheres (spheres, node.index, node.index + node.sphereCount,
+                            packedRay, nearestT, nearestObject);
+            NearestTetPars (tetpars, node.tetparIndex, node.tetparIndex + node.tetparCount,
+                            packedRay, nearestT, nearestObject);
+            continue;
+        }
+
+        // Push the far child first so that the near child is visited first, which tightens the
+        // hit distance sooner and culls more of the far side.
+
+        auto first  = static_cast<uint32_t>(&node - nodes.data()) + 1;
+        auto second = node.index;
+
+        if (ray.direction[node.axis] < 0.0)
+            std::swap(first, second);
+
+        stack[top++] = second;
+        stack[top++] = first;
+    }
+}
+
+//__________________________________________________________________________________________________
+
+bool BVHNearest (const Ray4 &ray, HitRecord &hit) {
+    // This routine finds the nearest intersection of the ray with the scene objects, following the
+    // rules of the object intersection functions (see r4_hit.cpp). Returns true if the hit record
+    // was updated.
+
+    const auto *hitObject = hit.object;
+
+    for (auto object : unbounded)
+        (*object->intersect)(object, ray, hit);
+
+    // The packed primitive loops track only the nearest distance and object. If they find a nearer
+    // object, fill in the rest of the hit record by intersecting that object alone. In double
+    // precision this yields the same distance. In single precision, a ray that only grazes the
+    // object may miss it in double precision, and the hit record is then left as it was.
+
+    double         nearestT      = hit.t;       // Nearest Intersection Distance
+    const ObjInfo *nearestObject = hit.object;  // Nearest Object
+
+    if (precision == Precision::Float)
+        NearestPacked (packedf, ray, nearestT, nearestObject);
+    else
+        NearestPacked (packed, ray, nearestT, nearestObject);
+
+    if (nearestObject != hit.object) {
+        HitRecord nearest;  // Nearest Packed Object Intersection
+
+        if ((*nearestObject->intersect)(nearestObject, ray, nearest))
+            hit = nearest;
+    }
+
+    return hit.object != hitObject;
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+static void NearestPacketPacked (
+    const PackedPrimitives<Real> &primitives,  // Packed Primitives
+    const RayPacketT<Real>       &packet,      // Packet of Trace Rays
+    PacketHits                   &hits)        // Nearest Intersections
+{
+    // This routine finds the nearest intersections of the packet rays with the packed primitives.
+    // The packet descends into every node that any of its rays hit, and tests each primitive it
+    // reaches against all of its rays.
+
+    const auto &spheres = primitives.spheres;
+    const auto &tetpars = primitives.tetpars;
+
+    bool cullable = true;
+    for (auto i = 0;  i < packet.count;  ++i)
+        cullable = cullable && IsCullable(packet.ray[i]);
+
+    if (!cullable) {
+        if constexpr (std::is_same_v<Real, float>) {
+            for (auto i = 0;  i < packet.count;  ++i) {
+                NearestUnpacked (spheres.object, packet.ray[i], hits.t[i], hits.object[i]);
+                NearestUnpacked (tetpars.object, packet.ray[i], hits.t[i], hits.object[i]);
+            }
+        } else {
+            NearestSpheresPacket (spheres, 0, spheres.size(), packet, hits);
+            NearestTetParsPacket (tetpars, 0, tetpars.size(), packet, hits);
+        }
+        return;
+    }
+
+    Vector4 invDir[MAX_PACKET];  // Reciprocal Ray Directions
+    for (auto i = 0;  i < packet.count;  ++i)
+        invDir[i] = Reciprocal(packet.ray[i].direction);
+
+    uint32_t stack[BVH_STACK_SIZE];  // Pending Node Stack
+    int      top = 0;                // Stack Size
+
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const auto &node = nodes[stack[--top]];
+
+        bool hitNode = false;
+        for (auto i = 0;  i < packet.count && !hitNode;  ++i) {
+            const auto tmax = (hits.t[i] > 0) ? hits.t[i] : std::numeric_limits<double>::infinity();
+            hitNode = node.bounds.hit(packet.ray[i], invDir[i], 0.0, tmax);
+        }
+
+        if (!hitNode)
+            continue;
+
+        if (node.isLeaf()) {
+            NearestSpheresPacket (spheres, node.index, node.index + node.sphereCount, packet, hits);
+            NearestTetParsPacket (tetpars, node.tetparIndex, node.tetparIndex + node.tetparCount,
+                                  packet, hits);
+            continue;
+        }
+
+        // The rays of a packet are nearly parallel, so the first ray picks the near child for all.
+
+        auto first  = static_cast<uint32_t>(&node - nodes.data()) + 1;
+        auto second = node.index;
+
+        if (packet.ray[0].direction[node.axis] < 0.0)
+            std::swap(first, second);
+
+        stack[top++] = second;
+        stack[top++] = first;
+    }
+}
+
+//__________________________________________________________________________________________________
+
+void BVHNearestPacket (const RayPacket &packet, PacketHits &hits) {
+    // This routine finds the nearest intersection distance and object for every ray of the packet,
+    // with the same results as BVHNearest() would give for each ray on its own. Testing a primitive
+    // against a ray that didn't need it costs time but can't change the result, since the
+    // nearest-hit rules don't depend on the order objects are tested in.
+
+    // Objects outside the hierarchy are tested against one ray at a time.
+
+    for (auto object : unbounded) {
+        for (auto i = 0;  i < packet.count;  ++i) {
+            HitRecord hit;
+            hit.t      = hits.t[i];
+            hit.object = hits.object[i];
+
+            if ((*object->intersect)(object, packet.ray[i], hit)) {
+                hits.t[i]      = hit.t;
+                hits.object[i] = object;
+            }
+        }
+    }
+
+    if (precision != Precision::Float) {
+        NearestPacketPacked (packed, packet, hits);
+        return;
+    }
+
+    RayPacketf packetf;  // Packet Rays in Single Precision
+
+    for (auto i = 0;  i < packet.count;  ++i)
+        packetf.add(packet.ray[i]);
+
+    NearestPacketPacked (packedf, packetf, hits);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real, typename BlockTest>
+static bool PackedShadow (
+    const PackedPrimitives<Real> &primitives,  // Packed Primitives
+    const Ray4                   &ray,         // Shadow Ray, From Surface Point Towards Light
+    double                        maxdist,     // Distance to the Light (-1 for Directional Lights)
+    const BlockTest              &blocks)      // Returns True If an Occluding Object Blocks Light
+{
+    // This routine determines whether the shadow ray is blocked by any of the packed primitives,
+    // walking the hierarchy if the ray may be culled by it. Each primitive found in the way is
+    // passed to the blocks() function, and this routine returns true as soon as that does.
+
+    const auto &spheres = primitives.spheres;
+    const auto &tetpars = primitives.tetpars;
+    const Ray4T<Real> packedRay { ray };  // Shadow Ray in Packed Precision
+
+    // Tests runs of packed spheres and tetrahedrons/parallelepipeds, returning true if any of them
+    // blocks the light.
+
+    auto packedBlock = [&](uint32_t sphereFirst, uint32_t sphereLimit,
+                           uint32_t tetparFirst, uint32_t tetparLimit) {
+        for (auto i = OccludingSphere(spheres, sphereFirst, sphereLimit, packedRay, maxdist);
+                  i < sphereLimit;
+                  i = OccludingSphere(spheres, i + 1, sphereLimit, packedRay, maxdist)) {
+            if (blocks(spheres.object[i]))
+                return true;
+        }
+
+        for (auto i = OccludingTetPar(tetpars, tetparFirst, tetparLimit, packedRay, maxdist);
+                  i < tetparLimit;
+                  i = OccludingTetPar(tetpars, i + 1, tetparLimit, packedRay, maxdist)) {
+            if (blocks(tetpars.object[i]))
+                return true;
+        }
+
+        return false;
+    };
+
+    if (!IsCullable(ray)) {
+        if constexpr (std::is_same_v<Real, float>) {
+            // As for NearestUnpacked(), test rays that aren't unit length in double precision.
+
+            for (auto objects : { &spheres.object, &tetpars.object }) {
+                for (auto object : *objects) {
+                    if ((*object->occlude)(object, ray, maxdist) && blocks(object))
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        return packedBlock(0, spheres.size(), 0, tetpars.size());
+    }
+
+    const auto invDir = Reciprocal(ray.direction);
+    const auto tmax   = (maxdist > 0) ? maxdist : std::numeric_limits<double>::infinity();
+
+    uint32_t stack[BVH_STACK_SIZE];  // Pending Node Stack
+    int      top = 0;                // Stack Size
+
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const auto &node = nodes[stack[--top]];
+
+        if (!node.bounds.hit(ray, invDir, 0.0, tmax))
+            continue;
+
+        if (node.isLeaf()) {
+            if (packedBlock(node.index, node.index + node.sphereCount,
+                            node.tetparIndex, node.tetparIndex + node.tetparCount))
+                return true;
+            continue;
+        }
+
+        // Visit the near child first, where a blocker is most likely to be found soonest.
+
+        auto first  = static_cast<uint32_t>(&node - nodes.data()) + 1;
+        auto second = node.index;
+
+        if (ray.direction[node.axis] < 0.0)
+            std::swap(first, second);
+
+        stack[top++] = second;
+        stack[top++] = first;
+    }
+
+    return false;
+}
+
+//__________________________________________________________________________________________________
+
+bool BVHShadow (
+    const Ray4     &ray,      // Shadow Ray, From Surface Point Towards Light
+    double          maxdist,  // Distance to the Light (-1 for Directional Lights)
+    Color          &lcolor,   // Light Color, Filtered By Transparent Occluders
+    const ObjInfo* &blocker)  // Opaque Object Found Blocking the Light
+{
+    // This routine determines whether the shadow ray is blocked by any opaque object between the
+    // surface point and the light. Transparent objects in the way filter the light color by their
+    // transparent color. Returns true as soon as any opaque object is found to block the light,
+    // and sets blocker to that object. This uses the object occlusion functions and their packed
+    // equivalents, which don't compute intersection details.
+
+    // Given an object that lies in the way, returns true if it blocks the light, or filters the
+    // light color and returns false if it's transparent.
+
+    auto blocks = [&](const ObjInfo *object) {
+        if (!(object->attr->flags & AT_TRANSPAR)) {
+            blocker = object;
+            return true;
+        }
+
+        lcolor *= object->attr->Kt;
+        return false;
+    };
+
+    for (auto object : unbounded) {
+        if ((*object->occlude)(object, ray, maxdist) && blocks(object))
+            return true;
+    }
+
+    if (precision == Precision::Float)
+        return PackedShadow (packedf, ray, maxdist, blocks);
+
+    return PackedShadow (packed, ray, maxdist, blocks);
+}
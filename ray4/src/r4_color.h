@@ -28,27 +28,57 @@ class Color {
     double r, g, b;  // Each color should be in [0,1].
 
     Color() = default;
-    Color(const Color&) = default;
+    constexpr Color(const Color&) = default;
     ~Color() = default;
 
-    Color(double red, double green, double blue) : r(red), g(green), b(blue) {}
+    constexpr Color(double red, double green, double blue) : r(red), g(green), b(blue) {}
 
-    bool operator== (const Color& other) const;
-    bool operator!= (const Color& other) const;
+    constexpr bool operator== (const Color& other) const {
+        return r == other.r && g == other.g && b == other.b;
+    }
 
-    Color& operator*= (double);
-    Color& operator*= (const Color&);
-    Color& operator+= (const Color&);
+    constexpr bool operator!= (const Color& other) const {
+        return !(*this == other);
+    }
 
-    Color operator* (double) const;
-    Color operator* (const Color&) const;
+    constexpr Color& operator*= (double scale) {
+        r *= scale;
+        g *= scale;
+        b *= scale;
+        return *this;
+    }
+
+    constexpr Color& operator*= (const Color& other) {
+        r *= other.r;
+        g *= other.g;
+        b *= other.b;
+        return *this;
+    }
+
+    constexpr Color& operator+= (const Color& other) {
+        r += other.r;
+        g += other.g;
+        b += other.b;
+        return *this;
+    }
+
+    constexpr Color operator* (double scale) const {
+        return {scale * r, scale * g, scale * b};
+    }
+
+    constexpr Color operator* (const Color& other) const {
+        return {r * other.r, g * other.g, b * other.b};
+    }
 
     // Clamps each color component to the range [min,max].
-    Color clamp(double min, double max) const;
+    constexpr Color clamp(double min, double max) const {
+        auto clampComponent = [=](double x) { return (x < min) ? min : (x > max) ? max : x; };
+        return {clampComponent(r), clampComponent(g), clampComponent(b)};
+    }
 };
 
 
-inline Color operator* (double d, const Color& c) {
+constexpr Color operator* (double d, const Color& c) {
     return c * d;
 }
 
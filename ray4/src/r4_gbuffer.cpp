@@ -0,0 +1,285 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// r4_gbuffer.cpp
+//
+// This file contains the primary-ray G-buffer cache (see the `--gbuffer` option). The nearest
+// intersection of every primary ray depends only on the scene geometry and the ray grid, not on the
+// lights or object attributes. The first render of a view saves the primary intersections to the
+// cache file, and later renders with the same geometry and view read them back instead of tracing
+// the primary rays, so that only shading, shadows and secondary rays are computed.
+//
+// The cache file starts with a header that identifies the scene geometry and the ray grid by hash,
+// followed by one record per traced voxel, in image order. Records are written in the native byte
+// order, so a cache file is only meant for the machine that wrote it.
+// See the r4_main.cpp header comment for more information on Ray4.
+//==================================================================================================
+
+#include "ray4.h"
+
+#include <cstring>
+#include <vector>
+
+
+// Constant Definitions
+
+const uint32_t GBUFFER_VERSION = 1;           // Cache File Format Version
+const uint32_t GBUFFER_NO_HIT  = UINT32_MAX;  // Object ID of Rays That Hit Nothing
+
+
+struct GBufferHeader {
+    char     magic[4];       // File Signature, "R4GB"
+    uint32_t version;        // File Format Version
+    uint64_t key;            // Hash of the Scene Geometry and Ray Grid
+    int32_t  resolution[3];  // Image Resolution
+    int32_t  zStart;         // First Traced Image Plane
+    int32_t  zLimit;         // One Past the Last Traced Image Plane
+    uint32_t reserved;       // Zero
+};
+
+struct GBufferRecord {
+    uint32_t objectId;   // Nearest Object ID (GBUFFER_NO_HIT -> None)
+    uint32_t reserved;   // Zero
+    double   t;          // Intersection Ray Parameter
+    double   normal[4];  // Surface Normal at Intersection Point
+    double   bary[3];    // Intersection Barycentric Coordinates
+};
+
+
+// File-Global Variables
+
+static FILE                        *gbufferFile = nullptr;           // Cache File Stream
+static GBufferMode                  gbufferMode = GBufferMode::None;  // Cache File Mode
+static std::vector<const ObjInfo*>  objectById;                      // Scene Objects by ID
+static std::vector<GBufferRecord>   records;                         // Slab Record Buffer
+
+
+
+//__________________________________________________________________________________________________
+
+static void HashBytes (uint64_t &hash, const void *data, size_t size) {
+    // Adds the bytes to the running FNV-1a hash.
+
+    auto bytes = static_cast<const unsigned char*>(data);
+
+    for (size_t i = 0;  i < size;  ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+//__________________________________________________________________________________________________
+
+static void HashPoints (uint64_t &hash, const Point4 *points, int count) {
+    // Adds the coordinates of the points to the running hash.
+
+    for (auto i = 0;  i < count;  ++i) {
+        for (auto axis = 0;  axis < 4;  ++axis) {
+            double coord = points[i][axis];
+            HashBytes (hash, &coord, sizeof(coord));
+        }
+    }
+}
+
+//__________________________________________________________________________________________________
+
+static uint64_t GeometryKey (const GBufferView &view) {
+    // Returns a hash of everything that determines the nearest primary intersections: the ray grid,
+    // the intersection precision and the shape of every object. Lights and attributes aren't
+    // included, since they only affect shading.
+
+    uint64_t hash = 0xcbf29ce484222325ull;  // FNV-1a Offset Basis
+
+    Point4 grid[] = {
+        view.origin, view.origin + view.gx, view.origin + view.gy, view.origin + view.gz, Vfrom
+    };
+    HashPoints (hash, grid, 5);
+
+    auto intersectPrecision = static_cast<int>(precision);
+    HashBytes (hash, &intersectPrecision, sizeof(intersectPrecision));
+
+    for (auto optr = objlist;  optr;  optr = optr->next) {
+        auto type = static_cast<int>(optr->type);
+        HashBytes (hash, &type, sizeof(type));
+        HashBytes (hash, &optr->id, sizeof(optr->id));
+
+        switch (optr->type) {
+            case ObjType::Sphere: {
+                auto sphere = reinterpret_cast<const Sphere*>(optr);
+                HashPoints (hash, &sphere->center, 1);
+                HashBytes (hash, &sphere->radius, sizeof(sphere->radius));
+                break;
+            }
+
+            case ObjType::Tetrahedron:
+                HashPoints (hash, reinterpret_cast<const Tetrahedron*>(optr)->tp.vert, 4);
+                break;
+
+            case ObjType::Parallelepiped:
+                HashPoints (hash, reinterpret_cast<const Parallelepiped*>(optr)->tp.vert, 4);
+                break;
+
+            case ObjType::Triangle:
+                HashPoints (hash, reinterpret_cast<const Triangle*>(optr)->vert, 3);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return hash;
+}
+
+//__________________________________________________________________________________________________
+
+GBufferMode OpenGBuffer (const char *fileName, const GBufferView &view) {
+    // This routine opens the G-buffer cache file for the given ray grid. If the file holds the
+    // primary intersections of the current scene geometry and ray grid, it is opened for reading.
+    // Otherwise it is (re)created for writing, to be filled in as the image is traced.
+
+    GBufferHeader expected {
+        { 'R', '4', 'G', 'B' }, GBUFFER_VERSION, GeometryKey(view),
+        { view.resolution[0], view.resolution[1], view.resolution[2] },
+        view.zStart, view.zLimit, 0
+    };
+
+    const uint64_t recordCount = static_cast<uint64_t>(view.resolution[0]) * view.resolution[1]
+                               * (view.zLimit - view.zStart);
+
+    // Check for a matching cache file, with a complete set of records.
+
+    if ((gbufferFile = fopen (fileName, "rb"))) {
+        GBufferHeader header;
+
+        bool matches = (1 == fread (&header, sizeof(header), 1, gbufferFile))
+                    && (0 == memcmp (&header, &expected, sizeof(header)));
+
+        if (matches) {
+            fseek (gbufferFile, 0, SEEK_END);
+            matches = (static_cast<uint64_t>(ftell(gbufferFile))
+                       == sizeof(header) + recordCount * sizeof(GBufferRecord));
+            fseek (gbufferFile, sizeof(header), SEEK_SET);
+        }
+
+        if (matches) {
+            for (auto optr = objlist;  optr;  optr = optr->next) {
+                if (objectById.size() <= optr->id)
+                    objectById.resize(optr->id + 1, nullptr);
+                objectById[optr->id] = optr;
+            }
+
+            return gbufferMode = GBufferMode::Read;
+        }
+
+        fclose (gbufferFile);
+    }
+
+    if (!(gbufferFile = fopen (fileName, "wb")))
+        Halt ("Open failed on G-buffer cache file (%s).", fileName);
+
+    if (1 != fwrite (&expected, sizeof(expected), 1, gbufferFile))
+        Halt ("Write error to G-buffer cache file (%s).", fileName);
+
+    return gbufferMode = GBufferMode::Write;
+}
+
+//__________________________________________________________________________________________________
+
+void ReadGBuffer (HitRecord *hits, size_t count) {
+    // Reads the next count primary intersections from the cache file. The intersection points
+    // aren't stored, since they follow from the rays; see ShadePrimary().
+
+    records.resize(count);
+
+    if (count != fread (records.data(), sizeof(GBufferRecord), count, gbufferFile))
+        Halt ("Read error on G-buffer cache file.");
+
+    for (size_t i = 0;  i < count;  ++i) {
+        const auto &record = records[i];
+        auto       &hit    = hits[i];
+
+        if (record.objectId == GBUFFER_NO_HIT || record.objectId >= objectById.size()) {
+            hit = HitRecord();
+            continue;
+        }
+
+        hit.object = objectById[record.objectId];
+        hit.t      = record.t;
+        for (auto axis = 0;  axis < 4;  ++axis)
+            hit.normal[axis] = record.normal[axis];
+        hit.Bc1    = record.bary[0];
+        hit.Bc2    = record.bary[1];
+        hit.Bc3    = record.bary[2];
+    }
+}
+
+//__________________________________________________________________________________________________
+
+void WriteGBuffer (const HitRecord *hits, size_t count) {
+    // Appends the given primary intersections to the cache file.
+
+    records.resize(count);
+
+    for (size_t i = 0;  i < count;  ++i) {
+        const auto &hit    = hits[i];
+        auto       &record = records[i];
+
+        record = GBufferRecord();
+
+        if (!hit.object) {
+            record.objectId = GBUFFER_NO_HIT;
+            continue;
+        }
+
+        record.objectId = hit.object->id;
+        record.t        = hit.t;
+        for (auto axis = 0;  axis < 4;  ++axis)
+            record.normal[axis] = hit.normal[axis];
+
+        // Spheres don't set barycentric coordinates.
+
+        if (hit.object->type != ObjType::Sphere) {
+            record.bary[0] = hit.Bc1;
+            record.bary[1] = hit.Bc2;
+            record.bary[2] = hit.Bc3;
+        }
+    }
+
+    if (count != fwrite (records.data(), sizeof(GBufferRecord), count, gbufferFile))
+        Halt ("Write error to G-buffer cache file.");
+}
+
+//__________________________________________________________________________________________________
+
+void CloseGBuffer () {
+    // Closes the cache file. A cache file that was being written is complete only once closed.
+
+    if (!gbufferFile)
+        return;
+
+    if (fclose (gbufferFile) != 0 && gbufferMode == GBufferMode::Write)
+        Halt ("Write error to G-buffer cache file.");
+
+    gbufferFile = nullptr;
+    gbufferMode = GBufferMode::None;
+}
@@ -0,0 +1,398 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// r4_grid.cpp
+//
+// This file contains the uniform grid accelerator, an alternative to the bounding volume hierarchy
+// (see r4_bvh.cpp) selected with `--accel grid`. The bounds of all bounded objects are divided into
+// a uniform 4D grid of cells, and each cell lists the objects whose bounds overlap it. Rays walk
+// the cells they pass through in order with a 4D digital differential analyzer (DDA), so the walk
+// stops at the first cell that holds the nearest hit. This suits dense scenes of many similarly
+// sized objects, where the cells stay small and evenly filled.
+//
+// The cell lists are stored in compressed sparse row (CSR) form: one array of object indices for
+// all cells, in cell order, and an array of the offset of each cell's run within it. Objects are
+// tested through their own intersection and occlusion functions, in double precision.
+// See the r4_main.cpp header comment for more information on Ray4.
+//==================================================================================================
+
+#include "ray4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+
+// Constant Definitions
+
+const double GRID_DENSITY   = 2.0;        // Target Number of Cells per Object
+const int    GRID_MAX_RES   = 64;         // Maximum Number of Cells Along Any Axis
+const size_t GRID_MAX_CELLS = 1 << 22;    // Maximum Total Number of Cells
+const double GRID_PAD       = 1e-9;       // Relative Box Padding, Guards Against Roundoff
+const double GRID_UNIT_TOL  = 1e-9;       // Tolerance for Unit-Length Ray Directions
+
+
+// File-Global Variables
+
+static Bounds4                     gridBounds;   // Bounds of All Grid Objects
+static int                         res[4];       // Number of Cells Along Each Axis
+static size_t                      stride[4];    // Cell Index Step Along Each Axis
+static Vector4                     cellSize;     // Cell Size Along Each Axis
+static std::vector<uint32_t>       cellStart;    // Start of Each Cell's Run in cellObjects
+static std::vector<uint32_t>       cellObjects;  // Object Indices of All Cells, In Cell Order
+static std::vector<const ObjInfo*> objects;      // Grid Objects
+static std::vector<const ObjInfo*> unbounded;    // Objects Without Finite Bounds
+
+// Each thread stamps the objects it tests for the current ray, so that an object spanning several
+// cells is tested only once per ray.
+
+static thread_local std::vector<uint32_t> mailbox;     // Last Ray Stamp for Each Object
+static thread_local uint32_t              rayStamp;    // Current Ray Stamp
+
+
+
+//__________________________________________________________________________________________________
+
+static int CellCoord (double coord, int axis) {
+    // Returns the cell coordinate along the axis that holds the given point coordinate.
+
+    auto cell = static_cast<int>(floor((coord - gridBounds.min[axis]) / cellSize[axis]));
+    return std::clamp(cell, 0, res[axis] - 1);
+}
+
+//__________________________________________________________________________________________________
+
+static void ChooseResolution (size_t objectCount) {
+    // Chooses the number of cells along each axis so that there are about GRID_DENSITY cells per
+    // object, with cells as close to hypercubes as the grid bounds allow. Axes along which the
+    // bounds are flat get a single cell.
+
+    auto extent  = gridBounds.extent();
+    auto largest = std::max({ extent.x, extent.y, extent.z, extent.w });
+
+    double volume = 1;
+    for (auto axis = 0;  axis < 4;  ++axis)
+        volume *= std::max(extent[axis], 1e-3 * largest);
+
+    const double cellsPerUnit = pow(GRID_DENSITY * objectCount / volume, 0.25);
+
+    for (auto axis = 0;  axis < 4;  ++axis) {
+        auto cells = static_cast<int>(extent[axis] * cellsPerUnit + 0.5);
+        res[axis] = std::clamp(cells, 1, GRID_MAX_RES);
+    }
+
+    // Halve the longest axis until the grid fits within the cell limit.
+
+    while (static_cast<size_t>(res[0]) * res[1] * res[2] * res[3] > GRID_MAX_CELLS) {
+        auto axis = static_cast<int>(std::max_element(res, res + 4) - res);
+        res[axis] = (res[axis] + 1) / 2;
+    }
+
+    stride[0] = 1;
+    for (auto axis = 1;  axis < 4;  ++axis)
+        stride[axis] = stride[axis-1] * res[axis-1];
+
+    for (auto axis = 0;  axis < 4;  ++axis)
+        cellSize[axis] = (extent[axis] > 0.0) ? extent[axis] / res[axis] : 1.0;
+}
+
+//__________________________________________________________________________________________________
+
+void BuildGrid () {
+    // This routine builds the uniform grid over all objects in the object list. It must be called
+    // after the scene has been parsed, and before any rays are traced.
+
+    std::vector<Bounds4> bounds;  // Padded Bounds of Each Grid Object
+
+    objects.clear();
+    unbounded.clear();
+    gridBounds = Bounds4::empty();
+
+    for (auto optr = objlist;  optr;  optr = optr->next) {
+        if (!optr->bounds.isFinite()) {
+            unbounded.push_back(optr);
+            continue;
+        }
+
+        // Pad the bounds slightly so that roundoff in the cell walk never skips a cell that holds
+        // an intersection the object's own intersection routine would accept.
+
+        auto box     = optr->bounds;
+        auto size    = box.extent();
+        auto largest = std::max({ fabs(box.min.x), fabs(box.min.y), fabs(box.min.z),
+                                  fabs(box.min.w), fabs(box.max.x), fabs(box.max.y),
+                                  fabs(box.max.z), fabs(box.max.w),
+                                  size.x, size.y, size.z, size.w });
+        box.pad(GRID_PAD * largest + epsilon);
+
+        objects.push_back(optr);
+        bounds.push_back(box);
+        gridBounds.include(box);
+    }
+
+    cellStart.clear();
+    cellObjects.clear();
+
+    if (objects.empty())
+        return;
+
+    ChooseResolution (objects.size());
+
+    // Find the range of cells [lo, hi] that each object overlaps along each axis. Then count the
+    // objects in each cell, turn the counts into run offsets, and fill in the runs.
+
+    struct CellRange { int lo[4], hi[4]; };
+    std::vector<CellRange> ranges (objects.size());
+
+    for (size_t i = 0;  i < objects.size();  ++i) {
+        for (auto axis = 0;  axis < 4;  ++axis) {
+            ranges[i].lo[axis] = CellCoord (bounds[i].min[axis], axis);
+            ranges[i].hi[axis] = CellCoord (bounds[i].max[axis], axis);
+        }
+    }
+
+    auto forEachCell = [](const CellRange &range, auto &&visit) {
+        for (auto w = range.lo[3];  w <= range.hi[3];  ++w)
+        for (auto z = range.lo[2];  z <= range.hi[2];  ++z)
+        for (auto y = range.lo[1];  y <= range.hi[1];  ++y)
+        for (auto x = range.lo[0];  x <= range.hi[0];  ++x)
+            visit(x*stride[0] + y*stride[1] + z*stride[2] + w*stride[3]);
+    };
+
+    const size_t cellCount = stride[3] * res[3];
+    cellStart.assign(cellCount + 1, 0);
+
+    for (const auto &range : ranges)
+        forEachCell(range, [](size_t cell) { ++cellStart[cell + 1]; });
+
+    for (size_t cell = 0;  cell < cellCount;  ++cell)
+        cellStart[cell + 1] += cellStart[cell];
+
+    cellObjects.resize(cellStart[cellCount]);
+
+    std::vector<uint32_t> fill (cellStart.begin(), cellStart.end() - 1);  // Next Free Slot per Cell
+
+    for (size_t i = 0;  i < ranges.size();  ++i)
+        forEachCell(ranges[i], [&](size_t cell) {
+            cellObjects[fill[cell]++] = static_cast<uint32_t>(i);
+        });
+}
+
+//__________________________________________________________________________________________________
+
+static bool IsCullable (const Ray4 &ray) {
+    // Returns true if the grid may be used to cull objects for the given ray. As for the hierarchy
+    // (see r4_bvh.cpp), rays that aren't unit length must be tested against every object.
+
+    return !cellStart.empty() && (fabs(ray.direction.normSquared() - 1.0) <= GRID_UNIT_TOL);
+}
+
+//__________________________________________________________________________________________________
+
+static bool FirstVisit (uint32_t object) {
+    // Returns true the first time the object is seen for the current ray.
+
+    if (mailbox[object] == rayStamp)
+        return false;
+
+    mailbox[object] = rayStamp;
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+static void NewRay () {
+    // Starts a new mailbox stamp for the next ray on this thread.
+
+    if (mailbox.size() != objects.size()) {
+        mailbox.assign(objects.size(), 0);
+        rayStamp = 0;
+    }
+
+    // On wraparound, clear the stamps so that no object appears already tested.
+
+    if (++rayStamp == 0) {
+        std::fill(mailbox.begin(), mailbox.end(), 0);
+        rayStamp = 1;
+    }
+}
+
+//__________________________________________________________________________________________________
+
+template<typename CellVisit>
+static bool WalkCells (
+    const Ray4      &ray,    // Ray to Walk
+    double           tmax,   // Maximum Ray Parameter
+    const CellVisit &visit)  // Returns True to Stop the Walk
+{
+    // This routine walks the grid cells along the ray in order, from the ray origin to tmax, with a
+    // 4D DDA. For each cell it calls visit(first, limit, cellExit) with the cell's run of
+    // cellObjects and the ray parameter where the ray leaves the cell. Returns true if the visit
+    // function stopped the walk.
+
+    const Vector4 invDir { 1.0 / ray.direction.x, 1.0 / ray.direction.y,
+                           1.0 / ray.direction.z, 1.0 / ray.direction.w };
+
+    double tEnter = 0.0;   // Ray Parameter Where the Ray Enters the Grid
+    double tExit  = tmax;  // Ray Parameter Where the Ray Leaves the Grid
+
+    if (!gridBounds.clip(ray, invDir, tEnter, tExit))
+        return false;
+
+    const auto entry = ray.origin + tEnter * ray.direction;
+
+    int    cell[4];   // Current Cell Coordinates
+    int    step[4];   // Cell Step Along Each Axis
+    double tNext[4];  // Ray Parameter of the Next Cell Boundary Along Each Axis
+    double tDelta[4]; // Ray Parameter Span of One Cell Along Each Axis
+    size_t index = 0; // Current Cell Index
+
+    for (auto axis = 0;  axis < 4;  ++axis) {
+        cell[axis] = CellCoord (entry[axis], axis);
+        index += cell[axis] * stride[axis];
+
+        const double dir = ray.direction[axis];
+        const double cellMin = gridBounds.min[axis] + cell[axis] * cellSize[axis];
+
+        if (dir > 0.0) {
+            step[axis]   = 1;
+            tNext[axis]  = (cellMin + cellSize[axis] - ray.origin[axis]) * invDir[axis];
+            tDelta[axis] = cellSize[axis] * invDir[axis];
+        } else if (dir < 0.0) {
+            step[axis]   = -1;
+            tNext[axis]  = (cellMin - ray.origin[axis]) * invDir[axis];
+            tDelta[axis] = -cellSize[axis] * invDir[axis];
+        } else {
+            step[axis]   = 0;
+            tNext[axis]  = std::numeric_limits<double>::infinity();
+            tDelta[axis] = 0.0;
+        }
+    }
+
+    while (true) {
+        auto axis = 0;  // Axis of the Nearest Cell Boundary
+        for (auto a = 1;  a < 4;  ++a) {
+            if (tNext[a] < tNext[axis])
+                axis = a;
+        }
+
+        const double cellExit = tNext[axis];
+
+        if (visit(cellStart[index], cellStart[index + 1], cellExit))
+            return true;
+
+        if (cellExit >= tExit)
+            return false;
+
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= res[axis])
+            return false;
+
+        index = (step[axis] > 0) ? index + stride[axis] : index - stride[axis];
+        tNext[axis] += tDelta[axis];
+    }
+}
+
+//__________________________________________________________________________________________________
+
+bool GridNearest (const Ray4 &ray, HitRecord &hit) {
+    // This routine finds the nearest intersection of the ray with the scene objects, with the same
+    // results as BVHNearest(). Returns true if the hit record was updated.
+
+    const auto *hitObject = hit.object;
+
+    for (auto object : unbounded)
+        (*object->intersect)(object, ray, hit);
+
+    if (!IsCullable(ray)) {
+        for (auto object : objects)
+            (*object->intersect)(object, ray, hit);
+        return hit.object != hitObject;
+    }
+
+    NewRay();
+
+    // An object may be hit beyond the cell it was found in, so the walk only stops once the nearest
+    // hit lies within the current cell; no object in a later cell can be nearer.
+
+    WalkCells (ray, std::numeric_limits<double>::infinity(),
+        [&](uint32_t first, uint32_t limit, double cellExit) {
+            for (auto i = first;  i < limit;  ++i) {
+                auto object = cellObjects[i];
+                if (FirstVisit(object))
+                    (*objects[object]->intersect)(objects[object], ray, hit);
+            }
+            return (hit.t > 0) && (hit.t <= cellExit);
+        });
+
+    return hit.object != hitObject;
+}
+
+//__________________________________________________________________________________________________
+
+bool GridShadow (
+    const Ray4     &ray,      // Shadow Ray, From Surface Point Towards Light
+    double          maxdist,  // Distance to the Light (-1 for Directional Lights)
+    Color          &lcolor,   // Light Color, Filtered By Transparent Occluders
+    const ObjInfo* &blocker)  // Opaque Object Found Blocking the Light
+{
+    // This routine determines whether the shadow ray is blocked by any opaque object between the
+    // surface point and the light, with the same results as BVHShadow(). Transparent objects in
+    // the way filter the light color, each exactly once.
+
+    auto blocks = [&](const ObjInfo *object) {
+        if (!(object->attr->flags & AT_TRANSPAR)) {
+            blocker = object;
+            return true;
+        }
+
+        lcolor *= object->attr->Kt;
+        return false;
+    };
+
+    for (auto object : unbounded) {
+        if ((*object->occlude)(object, ray, maxdist) && blocks(object))
+            return true;
+    }
+
+    if (!IsCullable(ray)) {
+        for (auto object : objects) {
+            if ((*object->occlude)(object, ray, maxdist) && blocks(object))
+                return true;
+        }
+        return false;
+    }
+
+    NewRay();
+
+    return WalkCells (ray, (maxdist > 0) ? maxdist : std::numeric_limits<double>::infinity(),
+        [&](uint32_t first, uint32_t limit, double) {
+            for (auto i = first;  i < limit;  ++i) {
+                auto object = cellObjects[i];
+                if (FirstVisit(object) && (*objects[object]->occlude)(objects[object], ray, maxdist)
+                                       && blocks(objects[object]))
+                    return true;
+            }
+            return false;
+        });
+}
@@ -31,7 +31,10 @@
 #include "ray4.h"
 
 
-#define MINDIST 1e-7  // Minimum Intersection Distance (for the elimination of surface acne)
+// Minimum Intersection Distance (for the elimination of surface acne), by Intersection Precision
+
+template<typename Real> constexpr double MINDIST        = 1e-7;
+template<>              constexpr double MINDIST<float> = 1e-7 * FLOAT_TOLERANCE_SCALE;
 
 
 
@@ -42,50 +45,118 @@
     //
     // The functions take the following parameter list:
     //
-    //     ObjInfo* objptr : Pointer to the Object Structure
-    //     Ray4     ray    : Ray Origin
-    //     double  *mindist: Closest Intersection Distance So Far
-    //     Point4  *intr   : Intersection Point
-    //     Vector4 *normal : Surface Normal at Intersection Point
+    //     ObjInfo*   objptr : Pointer to the Object Structure
+    //     Ray4       ray    : Ray Origin
+    //     HitRecord &hit    : Closest Intersection So Far
     //
-    // If the ray does not intersect the object, the intersection function returns false and does
-    // not alter `mindist', `intr' or `normal'.
+    // The object itself is never modified; everything learned about the intersection goes into the
+    // hit record, which belongs to the ray being traced. This keeps the scene read-only while
+    // tracing, so any number of rays may be traced concurrently.
     //
-    // If the mindist parameter is null, then it's assumed that the calling program is not
-    // interested in the specifics of the intersection; it's only interested in whether the ray
-    // intersects the object (as in shadow testing). In this case, if the ray does intersect the
-    // object, the function immediately returns true, but does not alter the `mindist', `intr' or
-    // `normal' parameters.
+    // If the ray does not intersect the object, the intersection function returns false and does
+    // not alter the hit record.
     //
-    // If the ray intersects the object, the intersection function returns true and the `mindist',
-    // `intr' and `normal' parameters are all set according to the intersection point if the
-    // following are true:
+    // If the ray intersects the object, the intersection function returns true and sets all of the
+    // hit record fields according to the intersection point if the following are true:
     //
-    //     1) The initial `mindist' value is -1, or
-    //     2) The intersection point is a positive (albeit small) epsilon distance along the ray and
-    //        is closer than the initial `mindist' value.
+    //     1) The intersection point is a positive (albeit small) MINDIST distance along the ray, and
+    //     2) The initial `hit.t' value is -1, or the intersection point is nearer than `hit.t', or
+    //        it lies at exactly `hit.t' and the object was defined before the current hit object.
     //
     // If these conditions are not met, then even if the ray intersects the object, the intersection
-    // function returns false.
+    // function returns false. Since these rules don't depend on the order in which objects are
+    // tested, the nearest intersection is the same however the scene is traversed.
+    //
+    // The barycentric coordinates are set for tetrahedrons, parallelepipeds (relative to the three
+    // edge vectors) and triangles (Bc3 is zero). They are undefined for other objects.
+    //
+    // Each object also has an occlusion function, used for shadow rays, which takes the maximum
+    // distance along the ray (-1 for no limit) in place of the hit record. It returns true if the
+    // intersection function would have accepted the intersection given a hit record with `hit.t'
+    // set to the maximum distance, but computes only the ray distance and whatever is needed to
+    // decide whether the ray passes through the object: no normal, intersection point or
+    // barycentric coordinates are recorded.
     //
-    // Note that these routines still behave properly if either the `intr' or `normal' parameters
-    // are null.
+    // Finally, the bounded primitives are also packed by type into structure-of-arrays form (see
+    // SphereArrays and TetParArrays), and the bounding volume hierarchy tests them with the
+    // type-specific loops at the end of this file rather than through the object function pointers.
+    // These loops apply the rules above to the nearest distance and object only, for single rays
+    // and ray packets alike. Their arithmetic must match the object functions exactly, so that the
+    // object's intersection function accepts the same nearest object when it's later called to fill
+    // in the full hit record.
+    //
+    // The packed loops are templated on their floating-point type. Primitives may be packed in
+    // single precision to halve their memory traffic, in which case the loops use a scaled
+    // MINDIST<float>, and the object's (double-precision) intersection function is called with an
+    // empty hit record to fill in the hit details.
     //==============================================================================================
 
 
 
 //__________________________________________________________________________________________________
 
-bool HitSphere (
-    ObjInfo    *objptr,    // Sphere to Test
-    const Ray4 &ray,       // Trace Ray
-    double     *mindist,   // Previous Minimum Distance
-    Point4     *intr,      // Intersection Point
-    Vector4    *normal)    // Surface Normal @ Intersection Point
+template<typename Real = double>
+static bool IsNearer (
+    double         nearestT,       // Nearest Intersection Distance So Far (-1 -> None)
+    const ObjInfo *nearestObject,  // Nearest Object So Far
+    double         t,              // Candidate Intersection Distance
+    const ObjInfo *objptr)         // Candidate Object
 {
-    // This is the intersection function for hyperspheres.
+    // Returns true if the candidate intersection should replace the current nearest intersection,
+    // according to the rules above. Ties go to the earliest defined object. Real is the precision
+    // that the candidate distance was computed in.
+
+    if (t < MINDIST<Real>)
+        return false;
 
-    const auto& sphere = *reinterpret_cast<Sphere*>(objptr);
+    if ((nearestT < 0) || (t < nearestT))
+        return true;
+
+    return (t == nearestT) && (!nearestObject || (objptr->id < nearestObject->id));
+}
+
+static bool IsNearer (const HitRecord &hit, double t, const ObjInfo *objptr) {
+    return IsNearer(hit.t, hit.object, t, objptr);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real = double>
+static bool IsInRange (double t, double maxdist) {
+    // Returns true if the candidate intersection lies within the range of an occlusion query. This
+    // matches IsNearer() for a hit record with no object and `hit.t' set to maxdist.
+
+    return (t >= MINDIST<Real>) && ((maxdist < 0) || (t <= maxdist));
+}
+
+//__________________________________________________________________________________________________
+
+static inline void CountTests (ObjType type, long long count = 1) {
+    // Counts intersection tests of the given object type in the thread statistics.
+    stats.tests[static_cast<int>(type)] += count;
+}
+
+static inline void CountHits (ObjType type, long long count = 1) {
+    // Counts intersections found for the given object type in the thread statistics.
+    stats.hits[static_cast<int>(type)] += count;
+}
+
+static inline bool CountHit (ObjType type, bool hit) {
+    // Counts an intersection found for the given object type, and returns the hit flag.
+    if (hit)
+        CountHits (type);
+    return hit;
+}
+
+//__________________________________________________________________________________________________
+
+static bool SphereDistance (
+    const Sphere &sphere,  // Sphere to Test
+    const Ray4   &ray,     // Trace Ray
+    double       &t)       // Ray Distance to Intersection
+{
+    // Finds the distance along the ray to the sphere surface. Returns false if the ray misses the
+    // sphere or the sphere is behind the ray.
 
     Vector4 cdir = sphere.center - ray.origin;   // Direction from Sphere Center to Eye
 
@@ -106,177 +177,247 @@ bool HitSphere (
     if (t1 <= 0.0)
         return false;
 
-    if (!mindist)
-        return true;
-
     // Note that the t1 variable is now the length of the vector from the ray origin to the
     // intersection point, since the direction vector is a unit vector.
 
-    if ((*mindist > 0) && ((t1 < MINDIST) || (t1 > *mindist)))
-        return false;      // Not closer than previous intersection.
+    t = t1;
+    return true;
+}
 
-    *mindist = t1;
+//__________________________________________________________________________________________________
 
-    if (intr)
-        (*intr) = ray(t1);
+bool HitSphere (
+    const ObjInfo *objptr,  // Sphere to Test
+    const Ray4    &ray,     // Trace Ray
+    HitRecord     &hit)     // Nearest Intersection
+{
+    // This is the intersection function for hyperspheres.
 
-    if (normal)
-        *normal = (*intr - sphere.center) / sphere.radius;
+    const auto& sphere = *reinterpret_cast<const Sphere*>(objptr);
 
-    return true;
+    CountTests (ObjType::Sphere);
+
+    double t;  // Ray Distance to Intersection
+
+    if (!SphereDistance(sphere, ray, t))
+        return false;
+
+    if (!IsNearer(hit, t, objptr))
+        return false;      // Not closer than previous intersection.
+
+    hit.t      = t;
+    hit.point  = ray(t);
+    hit.normal = (hit.point - sphere.center) / sphere.radius;
+    hit.object = objptr;
+
+    return CountHit (ObjType::Sphere, true);
 }
 
 //__________________________________________________________________________________________________
 
-bool HitTetPar (
-    ObjInfo    *objptr,     // Sphere to Test
-    const Ray4 &ray,       // Trace Ray
-    double     *mindist,    // Previous Minimum Distance
-    Point4     *intersect,  // Intersection Point
-    Vector4    *normal)     // Surface Normal @ Intersection Point
+bool OccludeSphere (
+    const ObjInfo *objptr,   // Sphere to Test
+    const Ray4    &ray,      // Shadow Ray
+    double         maxdist)  // Distance to Light (-1 -> Infinite)
 {
-    // This is the intersection function for 4D tetrahedrons and parallelepipeds. Note that if the
-    // object is a tetrahedron and the conditions are met to set the intersection values, then the
-    // barycentric coordinates of the tetrahedron will also be set. These values may be used later
-    // for Phong or Gouraud shading.
+    // This is the occlusion function for hyperspheres.
+
+    CountTests (ObjType::Sphere);
 
-    TetPar *tp;  // Tetrahdron/Parallelepiped Data
+    double t;  // Ray Distance to Intersection
+
+    return CountHit (ObjType::Sphere,
+                     SphereDistance(*reinterpret_cast<const Sphere*>(objptr), ray, t)
+                     && IsInRange(t, maxdist));
+}
+
+//__________________________________________________________________________________________________
+
+static const TetPar* TetParData (const ObjInfo *objptr) {
+    // Returns the tetrahedron/parallelepiped data for the given object.
 
     if (objptr->type == ObjType::Tetrahedron)
-        tp = &((reinterpret_cast<Tetrahedron*>(objptr))->tp);
+        return &((reinterpret_cast<const Tetrahedron*>(objptr))->tp);
     else
-        tp = &((reinterpret_cast<Parallelepiped*>(objptr))->tp);
+        return &((reinterpret_cast<const Parallelepiped*>(objptr))->tp);
+}
 
-    // Find the ray parameter to intersect the hyperplane.
+//__________________________________________________________________________________________________
+
+static bool TetParDistance (
+    const TetPar *tp,    // Tetrahedron/Parallelepiped Data
+    const Ray4   &ray,   // Trace Ray
+    double       &rayT)  // Ray Distance to Hyperplane Intersection
+{
+    // Finds the ray parameter to intersect the object's hyperplane. Returns false if the ray is
+    // parallel to the hyperplane, or the hyperplane is behind the ray.
 
-    double rayT = dot(tp->normal, ray.direction);  // Ray Equation Parameter
+    rayT = dot(tp->normal, ray.direction);  // Ray Equation Parameter
 
     if (fabs(rayT) < epsilon)  // If the ray is parallel to the hyperplane.
         return false;
 
     rayT = (-tp->planeConst - dot(tp->normal, ray.origin.toVector())) / rayT;
 
-    if (rayT < 0.0)      // If the object is behind the ray.
+    return (rayT >= 0.0);      // False if the object is behind the ray.
+}
+
+//__________________________________________________________________________________________________
+
+static inline void TetParBarycentric (
+    const TetPar *tp,   // Tetrahedron/Parallelepiped Data
+    const Point4 &P,    // Point on the Hyperplane
+    double       &Bc1,  // Intersection Barycentric Coordinates
+    double       &Bc2,
+    double       &Bc3)
+{
+    // Now we need to find the barycentric coordinates of the hyperplane point to determine if it's
+    // inside of the 4D object. Each coordinate is the dot product of the point with a row of the
+    // barycentric projection, plus a constant (see Process_TetPar()); the projection has the
+    // inverse of the Cramer's-rule determinant folded in, so no divisions are needed here.
+
+    const auto p = P.toVector();
+
+    Bc1 = dot(tp->bary[0], p) + tp->baryConst[0];
+    Bc2 = dot(tp->bary[1], p) + tp->baryConst[1];
+    Bc3 = dot(tp->bary[2], p) + tp->baryConst[2];
+}
+
+//__________________________________________________________________________________________________
+
+static inline bool TetParContains (
+    bool   isTetrahedron,  // True for Tetrahedrons, False for Parallelepipeds
+    double Bc1,            // Intersection Barycentric Coordinates
+    double Bc2,
+    double Bc3)
+{
+    // Test the barycentric coordinates to determine if the intersection point is within the object.
+
+    return !((Bc1 < 0.0) || (Bc1 > 1.0))
+        && !((Bc2 < 0.0) || (Bc2 > 1.0))
+        && !((Bc3 < 0.0) || (Bc3 > 1.0))
+        && (!isTetrahedron || ((Bc1 + Bc2 + Bc3) <= 1.0));
+}
+
+//__________________________________________________________________________________________________
+
+static bool TetParInside (
+    const ObjInfo *objptr,  // Tetrahedron or Parallelepiped
+    const TetPar  *tp,      // Tetrahedron/Parallelepiped Data
+    const Point4  &P,       // Point on the Hyperplane
+    double        &Bc1,     // Intersection Barycentric Coordinates
+    double        &Bc2,
+    double        &Bc3)
+{
+    // Returns true if the hyperplane intersection point lies within the object. The barycentric
+    // coordinates are also returned.
+
+    TetParBarycentric (tp, P, Bc1, Bc2, Bc3);
+    return TetParContains(objptr->type == ObjType::Tetrahedron, Bc1, Bc2, Bc3);
+}
+
+//__________________________________________________________________________________________________
+
+bool HitTetPar (
+    const ObjInfo *objptr,  // Tetrahedron or Parallelepiped to Test
+    const Ray4    &ray,     // Trace Ray
+    HitRecord     &hit)     // Nearest Intersection
+{
+    // This is the intersection function for 4D tetrahedrons and parallelepipeds. Note that if the
+    // conditions are met to set the intersection values, then the barycentric coordinates of the
+    // intersection point are also recorded. These values may be used later for Phong or Gouraud
+    // shading.
+
+    const TetPar *tp = TetParData(objptr);  // Tetrahdron/Parallelepiped Data
+
+    CountTests (objptr->type);
+
+    double rayT;  // Ray Equation Parameter
+
+    if (!TetParDistance(tp, ray, rayT))
         return false;
 
     // If we're testing for the nearest intersection, then we can trivially reject those candidate
     // intersection points that occur behind some other object in the scene.
 
-    if (mindist && (*mindist > 0) && ((rayT < MINDIST) || (rayT > *mindist)))
+    if (!IsNearer(hit, rayT, objptr))
         return false;
 
     Point4 intr = ray(rayT);  // Intersection Point
 
-    // Now we need to find the barycentric coordinates of the 4D object to determine if the
-    // ray/hyperplane intersection point is inside of the 4D object. To simplify the process,
-    // project the object to a 3-plane. In order to assure that we don't `squish' the object in the
-    // projection, select the three axes that are not dominant in the normal vector (the ax1, ax2
-    // and ax3 fields).
+    double Bc1,Bc2,Bc3;  // Intersection Barycentric Coordinates
 
-    // Use Cramer's rule to solve for the barycentric coordinates ((1-Bc1-Bc2-Bc3), Bc1, Bc2, Bc3)
-    // using the intersection point (I) of the object. The equation used is as follows:
-    //
-    //     M0 = (Bc1 * M1) + (Bc2 * M2) + (Bc3 * M3)
-    //
-    //             +-            -+             +-             -+
-    //             |I[ax1]-V0[ax1]|             |V1[ax1]-V0[ax1]|
-    // where M0 is |I[ax2]-V0[ax2]|       M1 is |V1[ax2]-V0[ax2]|
-    //             |I[ax3]-V0[ax3]|             |V1[ax3]-V0[ax3]|
-    //             +-            -+             +-             -+
-    //
-    //             +-             -+            +-             -+
-    //             |V2[ax1]-V0[ax1]|            |V3[ax1]-V0[ax1]|
-    //       M2 is |V2[ax2]-V0[ax2]|  and M3 is |V3[ax2]-V0[ax2]|
-    //             |V2[ax3]-V0[ax3]|            |V3[ax3]-V0[ax3]|
-    //             +-             -+            +-             -+
+    if (!TetParInside(objptr, tp, intr, Bc1, Bc2, Bc3))
+        return false;
 
-    double Bc1,Bc2,Bc3;  // Intersection Barycentric Coordinates
-    {
-        // Intermediate Values
-
-        double M01 = intr[tp->ax1] - tp->vert[0][tp->ax1];
-        double M02 = intr[tp->ax2] - tp->vert[0][tp->ax2];
-        double M03 = intr[tp->ax3] - tp->vert[0][tp->ax3];
-
-        double M11 = tp->vec1[tp->ax1];
-        double M12 = tp->vec1[tp->ax2];
-        double M13 = tp->vec1[tp->ax3];
-
-        double M21 = tp->vec2[tp->ax1];
-        double M22 = tp->vec2[tp->ax2];
-        double M23 = tp->vec2[tp->ax3];
-
-        double M31 = tp->vec3[tp->ax1];
-        double M32 = tp->vec3[tp->ax2];
-        double M33 = tp->vec3[tp->ax3];
-
-        double M22M33_M23M32 = (M22 * M33) - (M23 * M32);
-        double M02M33_M03M32 = (M02 * M33) - (M03 * M32);
-        double M12M03_M13M02 = (M12 * M03) - (M13 * M02);
-        double M12M33_M13M32 = (M12 * M33) - (M13 * M32);
-        double M12M23_M13M22 = (M12 * M23) - (M13 * M22);
-        double M02M23_M03M22 = (M02 * M23) - (M03 * M22);
-
-        Bc1 = ((M01*M22M33_M23M32) - (M21*M02M33_M03M32) + (M31*M02M23_M03M22)) / tp->CramerDiv;
-        if ((Bc1 < 0.0) || (Bc1 > 1.0))
-            return false;
-
-        Bc2 = ((M11*M02M33_M03M32) - (M01*M12M33_M13M32) + (M31*M12M03_M13M02)) / tp->CramerDiv;
-        if ((Bc2 < 0.0) || (Bc2 > 1.0))
-            return false;
-
-        Bc3 = (- (M11*M02M23_M03M22) - (M21*M12M03_M13M02) + (M01*M12M23_M13M22)) / tp->CramerDiv;
-        if ((Bc3 < 0.0) || (Bc3 > 1.0))
-            return false;
-    }
+    // At this point we know that the ray intersects the 4D object. We've already tested to see if
+    // the intersection point occurs behind some other object in the scene, so now we just load up
+    // the intersection parameters and return true.
 
-    // Test the barycentric coordinates to determine if the intersection point is within the object.
+    hit.t      = rayT;
+    hit.point  = intr;
+    hit.normal = tp->normal;
+    hit.Bc1    = Bc1;
+    hit.Bc2    = Bc2;
+    hit.Bc3    = Bc3;
+    hit.object = objptr;
 
-    if ((objptr->type == ObjType::Tetrahedron) && ((Bc1 + Bc2 + Bc3) > 1.0))
-        return false;
+    return CountHit (objptr->type, true);
+}
 
-    // At this point we know that the ray intersects the 4D object. If we're only testing for
-    // shadowing, return true immediately and leave the specific intersection parameters unaltered.
+//__________________________________________________________________________________________________
 
-    if (!mindist)
-        return true;
+bool OccludeTetPar (
+    const ObjInfo *objptr,   // Tetrahedron or Parallelepiped to Test
+    const Ray4    &ray,      // Shadow Ray
+    double         maxdist)  // Distance to Light (-1 -> Infinite)
+{
+    // This is the occlusion function for 4D tetrahedrons and parallelepipeds. Only the intersection
+    // point and its barycentric coordinates are computed.
 
-    // We've already tested to see if the intersection point occurs behind some other object in the
-    // scene, so now we just load up the intersection parameters and return true.
+    const TetPar *tp = TetParData(objptr);  // Tetrahdron/Parallelepiped Data
 
-    *mindist = rayT;
+    CountTests (objptr->type);
 
-    if (intersect)
-        (*intersect) = intr;
+    double rayT;  // Ray Equation Parameter
 
-    if (normal)
-        (*normal) = tp->normal;
+    if (!TetParDistance(tp, ray, rayT) || !IsInRange(rayT, maxdist))
+        return false;
 
-    if (objptr->type == ObjType::Tetrahedron) {
-        ((Tetrahedron*)(objptr))->Bc1 = Bc1;
-        ((Tetrahedron*)(objptr))->Bc2 = Bc2;
-        ((Tetrahedron*)(objptr))->Bc3 = Bc3;
-    }
+    double Bc1,Bc2,Bc3;  // Intersection Barycentric Coordinates (Unused)
 
-    return true;
+    return CountHit (objptr->type, TetParInside(objptr, tp, ray(rayT), Bc1, Bc2, Bc3));
 }
 
 //__________________________________________________________________________________________________
 
-bool HitTriangle (
-    ObjInfo    *objptr,     // Sphere to Test
-    const Ray4 &ray,       // Trace Ray
-    double     *mindist,    // Previous Minimum Distance
-    Point4     *intersect,  // Intersection Point
-    Vector4    *normal)     // Surface Normal @ Intersection Point
-{
-    // This is the intersection routine for 2D triangles in 4-space. If the ray intersects triangle
-    // and the conditions are met to set the intersection specifics, then the barycentric
-    // coordinates of the triangle will also be set according to the intersection point. These
-    // values will be used by the shading routines for Phong or Gouraud shading.
+static inline Vector4 TriangleCross (const Triangle &tri, const Vector4 &u) {
+    // Returns the 4D cross product cross(u, tri.vec1, tri.vec2), using the 2x2 minors of the edge
+    // vectors precomputed by Process_Triangle(). The arithmetic matches cross() exactly.
+
+    const double A = tri.minor[0];
+    const double B = tri.minor[1];
+    const double C = tri.minor[2];
+    const double D = tri.minor[3];
+    const double E = tri.minor[4];
+    const double F = tri.minor[5];
+
+    return {
+          (u.y * F) - (u.z * E) + (u.w * D),
+        - (u.x * F) + (u.z * C) - (u.w * B),
+          (u.x * E) - (u.y * C) + (u.w * A),
+        - (u.x * D) + (u.y * B) - (u.z * A)
+    };
+}
 
-    auto &tri = *reinterpret_cast<Triangle*>(objptr);
+//__________________________________________________________________________________________________
 
+static bool TriangleDistance (
+    const Triangle &tri,       // Triangle to Test
+    const Ray4     &ray,       // Trace Ray
+    double         &rayT,      // Ray Distance to Intersection
+    Vector4        &rayCross)  // Cross Product of Ray Direction and Triangle Edges
+{
     // The following segment calculates the intersection point (if one exists) with the ray and the
     // plane containing the polygon. The equation for this is as follows:
     //
@@ -288,31 +429,26 @@ bool HitTriangle (
     //                         | rayD x vec1, vec2 |
     //
     // V0 a vertex of the triangle, vec1 is the vector from V0 to another vertex, and vec2 is the
-    // vector from V0 to the other vertex.
+    // vector from V0 to the other vertex. The (rayD x vec1,vec2) term is returned in rayCross, since
+    // it's needed again for the triangle normal.
 
-    auto vecTemp2 = cross(ray.direction, tri.vec1, tri.vec2);
-    double div = vecTemp2.normSquared();  // Intersection Equation Divisor
+    rayCross = TriangleCross(tri, ray.direction);
+    double div = rayCross.normSquared();  // Intersection Equation Divisor
     if (div < epsilon)
         return false;
 
-    auto vecTemp1 = cross(tri.vert[0] - ray.origin, tri.vec1, tri.vec2);
+    auto vecTemp1 = TriangleCross(tri, tri.vert[0] - ray.origin);
 
-    double rayT = dot(vecTemp1, vecTemp2) / div;  // Ray Equation Real Parameter
+    rayT = dot(vecTemp1, rayCross) / div;
 
     // If the intersection point is behind the ray, then no intersection.
 
-    if (rayT < 0.0)
-        return false;
-
-    // If we've previously hit something and the current intersection distance is either less than
-    // epsilon or greater then the previous distance, then return false; we don't have a nearer
-    // intersection.
-
-    if (mindist && (*mindist > 0) && ((rayT < MINDIST) || (rayT > *mindist)))
-        return false;
+    return (rayT >= 0.0);
+}
 
-    Point4 intr = ray(rayT);  // Ray/Plane Intersection Point
+//__________________________________________________________________________________________________
 
+static Vector4 TriangleNormal (const Triangle &tri, const Vector4 &rayCross) {
     // Compute the triangle normal vector. Since the triangle is embedded in 2-space, we've got an
     // extra degree of freedom floating around, so we need to do some jazz to pin it down. To do
     // this I confine the normal vector to the 3-plane that contains the triangle and the ray. The
@@ -321,18 +457,17 @@ bool HitTriangle (
     // It turns out that this is fairly simple to do (although 4D cross products are quite expensive
     // computationally).
 
-    Vector4 _normal;  // Internal Normal Vector
-    {
-        auto Vtemp = cross(ray.direction, tri.vec1, tri.vec2);
-        _normal = cross(Vtemp, tri.vec1, tri.vec2);
-    }
+    return TriangleCross(tri, rayCross);
+}
+
+//__________________________________________________________________________________________________
 
+static void TriangleAxes (const Vector4 &_normal, int &ax1, int &ax2) {
     // In order to find the barycentric coordinates of the intersection point in the triangle, we
     // need to find the two minor axes of the normal vector. The intersection point and triangle can
     // then be projected to the plane spanned by the two minor axes without fear of "collapsing" the
     // triangle in the process.
 
-    int ax1, ax2;  // Dominant Axes, tri. Projection
     if (fabs(_normal[0]) < fabs(_normal[1])) {      // X, Y
         ax1 = 0;
         ax2 = 1;
@@ -358,7 +493,19 @@ bool HitTriangle (
             ax2 = 3;
         }
     }
+}
 
+//__________________________________________________________________________________________________
+
+static bool TriangleInside (
+    const Triangle &tri,   // Triangle to Test
+    int             ax1,   // Projection Axes
+    int             ax2,
+    double          Ix1,   // Intersection Point Coordinate on Axis ax1
+    double          Ix2,   // Intersection Point Coordinate on Axis ax2
+    double         &Bc1,   // Intersection Barycentric Coordinates
+    double         &Bc2)
+{
     // Now compute the barycentric coordinates of the intersection point relative to the three
     // vertices of the triangle. The equation used here is as follows (I=intersection point,
     // Vx=Triangle vertex):
@@ -377,39 +524,494 @@ bool HitTriangle (
     // where Bc1 and Bc2 are the barycentric coordinates for vertex 1 and vertex 2. The barycentric
     // coordinates for vertex 0 is (1-Bc1-Bc2).
 
-    {
-        double cramer_div;  // Cramer's Rule Divisor
-        double I1, I2;      // Matrix Entries
+    // The Cramer's rule divisor is the precomputed minor of the edge vectors for the two axes,
+    // negated if the axes are in descending order.
+
+    static const int minorIndex[4][4] {  // Index of the Minor for Each Axis Pair
+        { 0, 0, 1, 2 },
+        { 0, 0, 3, 4 },
+        { 1, 3, 0, 5 },
+        { 2, 4, 5, 0 }
+    };
+
+    double cramer_div;  // Cramer's Rule Divisor
+    double I1, I2;      // Matrix Entries
+
+    I1  = Ix1 - tri.vert[0][ax1];
+    I2  = Ix2 - tri.vert[0][ax2];
+    cramer_div = (ax1 < ax2) ?  tri.minor[minorIndex[ax1][ax2]]
+                             : -tri.minor[minorIndex[ax1][ax2]];
+
+    Bc1 = ((I1 * tri.vec2[ax2]) - (I2 * tri.vec2[ax1])) / cramer_div;
+
+    if ((Bc1 < 0.0) || (Bc1 > 1.0))
+        return false;
+
+    Bc2 = ((tri.vec1[ax1] * I2) - (tri.vec1[ax2] * I1)) / cramer_div;
+
+    return !((Bc2 <0.0) || (Bc2 >1.0) || ((Bc1+Bc2) >1.0));
+}
+
+//__________________________________________________________________________________________________
+
+bool HitTriangle (
+    const ObjInfo *objptr,  // Triangle to Test
+    const Ray4    &ray,     // Trace Ray
+    HitRecord     &hit)     // Nearest Intersection
+{
+    // This is the intersection routine for 2D triangles in 4-space. If the ray intersects triangle
+    // and the conditions are met to set the intersection specifics, then the barycentric
+    // coordinates of the intersection point are also recorded. These values will be used by the
+    // shading routines for Phong or Gouraud shading.
+
+    const auto &tri = *reinterpret_cast<const Triangle*>(objptr);
+
+    CountTests (ObjType::Triangle);
+
+    double  rayT;      // Ray Equation Real Parameter
+    Vector4 rayCross;  // Ray Direction x Triangle Edges
+
+    if (!TriangleDistance(tri, ray, rayT, rayCross))
+        return false;
+
+    // If we've previously hit something and the current intersection distance is either less than
+    // epsilon or greater then the previous distance, then return false; we don't have a nearer
+    // intersection.
+
+    if (!IsNearer(hit, rayT, objptr))
+        return false;
+
+    Point4 intr = ray(rayT);  // Ray/Plane Intersection Point
+
+    Vector4 _normal = TriangleNormal(tri, rayCross);  // Internal Normal Vector
 
-        I1  = intr[ax1] - tri.vert[0][ax1];
-        I2  = intr[ax2] - tri.vert[0][ax2];
-        cramer_div = (tri.vec1[ax1] * tri.vec2[ax2])
-                   - (tri.vec1[ax2] * tri.vec2[ax1]);
+    int ax1, ax2;  // Dominant Axes, tri. Projection
+    TriangleAxes (_normal, ax1, ax2);
+
+    double Bc1, Bc2;  // Intersection Barycentric Coordinates
+
+    if (!TriangleInside(tri, ax1, ax2, intr[ax1], intr[ax2], Bc1, Bc2))
+        return false;
+
+    // At this point we know that the ray intersects the 2D triangle. We've already tested to see if
+    // the intersection point occurs behind some other object in the scene, so now we just load up
+    // the intersection parameters and return true.
 
-        tri.Bc1 = ((I1 * tri.vec2[ax2]) - (I2 * tri.vec2[ax1])) / cramer_div;
+    hit.t      = rayT;
+    hit.point  = intr;
+    hit.normal = _normal;
+    hit.Bc1    = Bc1;
+    hit.Bc2    = Bc2;
+    hit.Bc3    = 0.0;
+    hit.object = objptr;
 
-        if ((tri.Bc1 < 0.0) || (tri.Bc1 > 1.0))
-            return false;
+    return CountHit (ObjType::Triangle, true);
+}
+
+//__________________________________________________________________________________________________
+
+bool OccludeTriangle (
+    const ObjInfo *objptr,   // Triangle to Test
+    const Ray4    &ray,      // Shadow Ray
+    double         maxdist)  // Distance to Light (-1 -> Infinite)
+{
+    // This is the occlusion routine for 2D triangles in 4-space. The normal direction is still
+    // needed to pick the projection axes, but only the two projected coordinates of the
+    // intersection point are computed.
+
+    const auto &tri = *reinterpret_cast<const Triangle*>(objptr);
+
+    CountTests (ObjType::Triangle);
+
+    double  rayT;      // Ray Equation Real Parameter
+    Vector4 rayCross;  // Ray Direction x Triangle Edges
+
+    if (!TriangleDistance(tri, ray, rayT, rayCross) || !IsInRange(rayT, maxdist))
+        return false;
+
+    int ax1, ax2;  // Dominant Axes, tri. Projection
+    TriangleAxes (TriangleNormal(tri, rayCross), ax1, ax2);
+
+    double Bc1, Bc2;  // Intersection Barycentric Coordinates (Unused)
+
+    return CountHit (ObjType::Triangle,
+                     TriangleInside(tri, ax1, ax2,
+                                    ray.origin[ax1] + rayT * ray.direction[ax1],
+                                    ray.origin[ax2] + rayT * ray.direction[ax2],
+                                    Bc1, Bc2));
+}
+
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+void SphereArraysT<Real>::add (const ObjInfo *objptr) {
+    // Appends a sphere to the packed sphere arrays.
+
+    const auto& sphere = *reinterpret_cast<const Sphere*>(objptr);
+
+    cx.push_back(static_cast<Real>(sphere.center.x));
+    cy.push_back(static_cast<Real>(sphere.center.y));
+    cz.push_back(static_cast<Real>(sphere.center.z));
+    cw.push_back(static_cast<Real>(sphere.center.w));
+    rsqrd.push_back(static_cast<Real>(sphere.rsqrd));
+    object.push_back(objptr);
+}
+
+//__________________________________________________________________________________________________
 
-        tri.Bc2 = ((tri.vec1[ax1] * I2) - (tri.vec1[ax2] * I1)) / cramer_div;
+template<typename Real>
+void TetParArraysT<Real>::add (const ObjInfo *objptr) {
+    // Appends a tetrahedron or parallelepiped to the packed arrays.
 
-        if ((tri.Bc2 <0.0) || (tri.Bc2 >1.0) || ((tri.Bc1+tri.Bc2) >1.0))
-            return false;
+    const TetPar *tp = TetParData(objptr);  // Tetrahdron/Parallelepiped Data
+
+    nx.push_back(static_cast<Real>(tp->normal.x));
+    ny.push_back(static_cast<Real>(tp->normal.y));
+    nz.push_back(static_cast<Real>(tp->normal.z));
+    nw.push_back(static_cast<Real>(tp->normal.w));
+    planeConst.push_back(static_cast<Real>(tp->planeConst));
+
+    for (auto k = 0;  k < 3;  ++k) {
+        bx[k].push_back(static_cast<Real>(tp->bary[k].x));
+        by[k].push_back(static_cast<Real>(tp->bary[k].y));
+        bz[k].push_back(static_cast<Real>(tp->bary[k].z));
+        bw[k].push_back(static_cast<Real>(tp->bary[k].w));
+        bc[k].push_back(static_cast<Real>(tp->baryConst[k]));
     }
 
-    // At this point we know that the ray intersects the 2D triangle. If we're only testing for
-    // shadowing, return true immediately and leave the specific intersection parameters unaltered.
+    isTetrahedron.push_back(objptr->type == ObjType::Tetrahedron);
+    object.push_back(objptr);
+}
 
-    if (!mindist)
-        return true;
+//__________________________________________________________________________________________________
 
-    // We've already tested to see if the intersection point occurs behind some other object in the
-    // scene, so now we just load up the intersection parameters and return true.
+template<typename Real>
+static inline Real PackedSphereDistance (
+    const SphereArraysT<Real> &spheres,    // Packed Spheres
+    uint32_t                   i,          // Index of Sphere to Test
+    const Real                 origin[4],  // Ray Origin Coordinates
+    const Real                 dir[4])     // Ray Direction Coordinates
+{
+    // This is a branch-free copy of SphereDistance() for a packed sphere. Returns the distance
+    // along the ray to the sphere surface, or -1 if the ray misses the sphere or the sphere is
+    // behind the ray.
 
-    *mindist = rayT;
+    Real cx = spheres.cx[i] - origin[0];  // Direction from Sphere Center to Eye
+    Real cy = spheres.cy[i] - origin[1];
+    Real cz = spheres.cz[i] - origin[2];
+    Real cw = spheres.cw[i] - origin[3];
 
-    (*intersect) = intr;
-    (*normal)    = _normal;
+    Real bb  = (cx * dir[0]) + (cy * dir[1]) + (cz * dir[2]) + (cw * dir[3]);
+    Real rad = (bb * bb) - ((cx * cx) + (cy * cy) + (cz * cz) + (cw * cw)) + spheres.rsqrd[i];
 
-    return true;
+    Real root = sqrt((rad < 0) ? Real(0) : rad);
+    Real t1 = bb + root;
+    Real t2 = bb - root;
+
+    if ((t1 < 0) || ((t2 > 0) && (t2 < t1)))
+        t1 = t2;
+
+    return ((rad < 0) || (t1 <= 0)) ? Real(-1) : t1;
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+static inline Real PackedTetParDistance (
+    const TetParArraysT<Real> &tetpars,    // Packed Tetrahedrons/Parallelepipeds
+    uint32_t                   i,          // Index of Object to Test
+    const Real                 origin[4],  // Ray Origin Coordinates
+    const Real                 dir[4])     // Ray Direction Coordinates
+{
+    // This is a copy of TetParDistance() for a packed object. Returns the distance along the ray to
+    // the hyperplane intersection, or -1 if the ray is parallel to the hyperplane or the hyperplane
+    // is behind the ray.
+
+    Real NdotD = (tetpars.nx[i] * dir[0]) + (tetpars.ny[i] * dir[1])
+               + (tetpars.nz[i] * dir[2]) + (tetpars.nw[i] * dir[3]);
+
+    if (fabs(NdotD) < epsilon)
+        return -1;
+
+    Real NdotO = (tetpars.nx[i] * origin[0]) + (tetpars.ny[i] * origin[1])
+               + (tetpars.nz[i] * origin[2]) + (tetpars.nw[i] * origin[3]);
+
+    Real rayT = (-tetpars.planeConst[i] - NdotO) / NdotD;
+
+    return (rayT >= 0) ? rayT : Real(-1);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+static inline bool PackedTetParInside (
+    const TetParArraysT<Real> &tetpars,    // Packed Tetrahedrons/Parallelepipeds
+    uint32_t                   i,          // Index of Object to Test
+    const Real                 origin[4],  // Ray Origin Coordinates
+    const Real                 dir[4],     // Ray Direction Coordinates
+    Real                       rayT)       // Ray Distance to Hyperplane Intersection
+{
+    // This is a copy of TetParInside() for a packed object, given the ray distance to the
+    // hyperplane intersection point.
+
+    const Real Px = origin[0] + rayT * dir[0];  // Intersection Point
+    const Real Py = origin[1] + rayT * dir[1];
+    const Real Pz = origin[2] + rayT * dir[2];
+    const Real Pw = origin[3] + rayT * dir[3];
+
+    Real Bc[3];  // Intersection Barycentric Coordinates
+
+    for (auto k = 0;  k < 3;  ++k) {
+        Bc[k] = (tetpars.bx[k][i] * Px) + (tetpars.by[k][i] * Py) + (tetpars.bz[k][i] * Pz)
+              + (tetpars.bw[k][i] * Pw) + tetpars.bc[k][i];
+    }
+
+    return TetParContains(tetpars.isTetrahedron[i], Bc[0], Bc[1], Bc[2]);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+static void CountTetParTests (
+    const TetParArraysT<Real> &tetpars,  // Packed Tetrahedrons/Parallelepipeds
+    uint32_t                   first,    // First Object Tested
+    uint32_t                   limit,    // One Past the Last Object Tested
+    long long                  rays)     // Number of Rays Tested Against Each Object
+{
+    // Counts the tests of a run of packed tetrahedrons and parallelepipeds in the statistics.
+
+    long long tetrahedrons = 0;  // Number of Tetrahedrons in the Run
+
+    for (auto i = first;  i < limit;  ++i)
+        tetrahedrons += tetpars.isTetrahedron[i];
+
+    CountTests (ObjType::Tetrahedron,    rays * tetrahedrons);
+    CountTests (ObjType::Parallelepiped, rays * (limit - first - tetrahedrons));
 }
+
+//__________________________________________________________________________________________________
+
+static void CountTetParHits (const long long hits[2]) {
+    // Counts the hits found in a run of packed objects, given the hits on parallelepipeds and on
+    // tetrahedrons, indexed by the isTetrahedron flag.
+
+    CountHits (ObjType::Parallelepiped, hits[0]);
+    CountHits (ObjType::Tetrahedron,    hits[1]);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+void NearestSpheres (
+    const SphereArraysT<Real> &spheres,         // Packed Spheres
+    uint32_t                   first,           // First Sphere to Test
+    uint32_t                   limit,           // One Past the Last Sphere to Test
+    const Ray4T<Real>         &ray,             // Trace Ray
+    double                    &nearestT,        // Nearest Intersection Distance So Far (-1 -> None)
+    const ObjInfo*            &nearestObject)   // Nearest Object So Far
+{
+    // Tests the packed spheres [first, limit) against the ray, updating the nearest intersection
+    // distance and object as HitSphere() would.
+
+    const Real origin[4] { ray.origin.x, ray.origin.y, ray.origin.z, ray.origin.w };
+    const Real dir[4]    { ray.direction.x, ray.direction.y, ray.direction.z, ray.direction.w };
+
+    long long hits = 0;  // Nearer Intersections Found
+
+    for (auto i = first;  i < limit;  ++i) {
+        double t = PackedSphereDistance(spheres, i, origin, dir);
+
+        if (IsNearer<Real>(nearestT, nearestObject, t, spheres.object[i])) {
+            nearestT      = t;
+            nearestObject = spheres.object[i];
+            ++hits;
+        }
+    }
+
+    CountTests (ObjType::Sphere, limit - first);
+    CountHits  (ObjType::Sphere, hits);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+void NearestSpheresPacket (
+    const SphereArraysT<Real> &spheres,  // Packed Spheres
+    uint32_t                   first,    // First Sphere to Test
+    uint32_t                   limit,    // One Past the Last Sphere to Test
+    const RayPacketT<Real>    &packet,   // Trace Rays
+    PacketHits                &nearest)  // Nearest Intersections
+{
+    // Tests the packed spheres [first, limit) against every ray of the packet.
+
+    long long hits = 0;  // Nearer Intersections Found
+
+    for (auto i = first;  i < limit;  ++i) {
+        for (auto r = 0;  r < packet.count;  ++r) {
+            const Real origin[4] { packet.ox[r], packet.oy[r], packet.oz[r], packet.ow[r] };
+            const Real dir[4]    { packet.dx[r], packet.dy[r], packet.dz[r], packet.dw[r] };
+
+            double t = PackedSphereDistance(spheres, i, origin, dir);
+
+            if (IsNearer<Real>(nearest.t[r], nearest.object[r], t, spheres.object[i])) {
+                nearest.t[r]      = t;
+                nearest.object[r] = spheres.object[i];
+                ++hits;
+            }
+        }
+    }
+
+    CountTests (ObjType::Sphere, static_cast<long long>(limit - first) * packet.count);
+    CountHits  (ObjType::Sphere, hits);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+void NearestTetPars (
+    const TetParArraysT<Real> &tetpars,         // Packed Tetrahedrons/Parallelepipeds
+    uint32_t                   first,           // First Object to Test
+    uint32_t                   limit,           // One Past the Last Object to Test
+    const Ray4T<Real>         &ray,             // Trace Ray
+    double                    &nearestT,        // Nearest Intersection Distance So Far (-1 -> None)
+    const ObjInfo*            &nearestObject)   // Nearest Object So Far
+{
+    // Tests the packed tetrahedrons and parallelepipeds [first, limit) against the ray, updating
+    // the nearest intersection distance and object as HitTetPar() would.
+
+    const Real origin[4] { ray.origin.x, ray.origin.y, ray.origin.z, ray.origin.w };
+    const Real dir[4]    { ray.direction.x, ray.direction.y, ray.direction.z, ray.direction.w };
+
+    long long hits[2] { };  // Nearer Intersections Found, By isTetrahedron
+
+    for (auto i = first;  i < limit;  ++i) {
+        Real rayT = PackedTetParDistance(tetpars, i, origin, dir);
+
+        if (IsNearer<Real>(nearestT, nearestObject, rayT, tetpars.object[i])
+                && PackedTetParInside(tetpars, i, origin, dir, rayT)) {
+            nearestT      = rayT;
+            nearestObject = tetpars.object[i];
+            ++hits[tetpars.isTetrahedron[i]];
+        }
+    }
+
+    CountTetParTests (tetpars, first, limit, 1);
+    CountTetParHits (hits);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+void NearestTetParsPacket (
+    const TetParArraysT<Real> &tetpars,  // Packed Tetrahedrons/Parallelepipeds
+    uint32_t                   first,    // First Object to Test
+    uint32_t                   limit,    // One Past the Last Object to Test
+    const RayPacketT<Real>    &packet,   // Trace Rays
+    PacketHits                &nearest)  // Nearest Intersections
+{
+    // Tests the packed tetrahedrons and parallelepipeds [first, limit) against every ray of the
+    // packet.
+
+    long long hits[2] { };  // Nearer Intersections Found, By isTetrahedron
+
+    for (auto i = first;  i < limit;  ++i) {
+        for (auto r = 0;  r < packet.count;  ++r) {
+            const Real origin[4] { packet.ox[r], packet.oy[r], packet.oz[r], packet.ow[r] };
+            const Real dir[4]    { packet.dx[r], packet.dy[r], packet.dz[r], packet.dw[r] };
+
+            Real rayT = PackedTetParDistance(tetpars, i, origin, dir);
+
+            if (IsNearer<Real>(nearest.t[r], nearest.object[r], rayT, tetpars.object[i])
+                    && PackedTetParInside(tetpars, i, origin, dir, rayT)) {
+                nearest.t[r]      = rayT;
+                nearest.object[r] = tetpars.object[i];
+                ++hits[tetpars.isTetrahedron[i]];
+            }
+        }
+    }
+
+    CountTetParTests (tetpars, first, limit, packet.count);
+    CountTetParHits (hits);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+uint32_t OccludingSphere (
+    const SphereArraysT<Real> &spheres,  // Packed Spheres
+    uint32_t                   first,    // First Sphere to Test
+    uint32_t                   limit,    // One Past the Last Sphere to Test
+    const Ray4T<Real>         &ray,      // Shadow Ray
+    double                     maxdist)  // Distance to Light (-1 -> Infinite)
+{
+    // Returns the index of the first packed sphere in [first, limit) that OccludeSphere() would
+    // report as blocking the shadow ray, or limit if there is none.
+
+    const Real origin[4] { ray.origin.x, ray.origin.y, ray.origin.z, ray.origin.w };
+    const Real dir[4]    { ray.direction.x, ray.direction.y, ray.direction.z, ray.direction.w };
+
+    for (auto i = first;  i < limit;  ++i) {
+        if (IsInRange<Real>(PackedSphereDistance(spheres, i, origin, dir), maxdist)) {
+            CountTests (ObjType::Sphere, i + 1 - first);
+            CountHits  (ObjType::Sphere);
+            return i;
+        }
+    }
+
+    CountTests (ObjType::Sphere, limit - first);
+    return limit;
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+uint32_t OccludingTetPar (
+    const TetParArraysT<Real> &tetpars,  // Packed Tetrahedrons/Parallelepipeds
+    uint32_t                   first,    // First Object to Test
+    uint32_t                   limit,    // One Past the Last Object to Test
+    const Ray4T<Real>         &ray,      // Shadow Ray
+    double                     maxdist)  // Distance to Light (-1 -> Infinite)
+{
+    // Returns the index of the first packed tetrahedron or parallelepiped in [first, limit) that
+    // OccludeTetPar() would report as blocking the shadow ray, or limit if there is none.
+
+    const Real origin[4] { ray.origin.x, ray.origin.y, ray.origin.z, ray.origin.w };
+    const Real dir[4]    { ray.direction.x, ray.direction.y, ray.direction.z, ray.direction.w };
+
+    for (auto i = first;  i < limit;  ++i) {
+        Real rayT = PackedTetParDistance(tetpars, i, origin, dir);
+
+        if (IsInRange<Real>(rayT, maxdist) && PackedTetParInside(tetpars, i, origin, dir, rayT)) {
+            CountTetParTests (tetpars, first, i + 1, 1);
+            CountHits (tetpars.object[i]->type);
+            return i;
+        }
+    }
+
+    CountTetParTests (tetpars, first, limit, 1);
+    return limit;
+}
+
+//__________________________________________________________________________________________________
+
+// Instantiate the packed primitives and their intersection loops for each render precision.
+
+#define INSTANTIATE_PACKED(Real)                                                                   \
+    template struct SphereArraysT<Real>;                                                           \
+    template struct TetParArraysT<Real>;                                                           \
+    template void NearestSpheres (const SphereArraysT<Real>&, uint32_t, uint32_t,                  \
+                                  const Ray4T<Real>&, double&, const ObjInfo*&);                   \
+    template void NearestSpheresPacket (const SphereArraysT<Real>&, uint32_t, uint32_t,            \
+                                        const RayPacketT<Real>&, PacketHits&);                     \
+    template void NearestTetPars (const TetParArraysT<Real>&, uint32_t, uint32_t,                  \
+                                  const Ray4T<Real>&, double&, const ObjInfo*&);                   \
+    template void NearestTetParsPacket (const TetParArraysT<Real>&, uint32_t, uint32_t,            \
+                                        const RayPacketT<Real>&, PacketHits&);                     \
+    template uint32_t OccludingSphere (const SphereArraysT<Real>&, uint32_t, uint32_t,             \
+                                       const Ray4T<Real>&, double);                                \
+    template uint32_t OccludingTetPar (const TetParArraysT<Real>&, uint32_t, uint32_t,             \
+                                       const Ray4T<Real>&, double);
+
+INSTANTIATE_PACKED(double)
+INSTANTIATE_PACKED(float)
@@ -23,6 +23,9 @@
 // r4_image.h
 //
 // This file contains structure and constant declarations for the ray4 image file output format.
+// There are two versions of the image file format, fully described in ray4-image-format.md. The
+// version 1 header is described below. Version 2 files use the ImageHeader_2 header, followed by
+// run-length encoded image data.
 //
 // The following assumptions are made in the header structure:
 //
@@ -67,6 +70,20 @@
 
 const uint32_t ray4FormatMagic = 0x52617934L;  // 'Ray4'
 
+// Version 2 Pixel Types
+
+const uint8_t pixelTypeRGB      = 0x00;  // RGB Unsigned Integers
+const uint8_t pixelTypeFloatRGB = 0x01;  // RGB Floating-Point Values
+
+// Version 2 Plane and Line Flags
+
+const uint8_t planeRegular    = 0x00;  // Plane of Ry Lines Follows
+const uint8_t planeBackground = 0x01;  // Plane of All Background Pixels
+
+const uint8_t lineRegular     = 0x00;  // Line of Rx Pixels Follows
+const uint8_t lineBackground  = 0x01;  // Line of All Background Pixels
+const uint8_t lineSpans       = 0x02;  // Line of Background/Pixel Spans Follows
+
 
 // Structure Definitions
 
@@ -79,4 +96,12 @@ struct ImageHeader_1 {
     uint16_t end[3];        // Ending Image Pixels for [X,Y,Z]
 };
 
+struct ImageHeader_2 {
+    uint32_t magic;          // Magic Number = R4_IMAGE_ID
+    uint8_t  version;        // Image File Version Number = 2
+    uint8_t  pixelType;      // Pixel Type
+    uint16_t bitsPerPixel;   // Number of Bits per Pixel
+    uint16_t resolution[3];  // Image Resolution [X,Y,Z]
+};
+
 #endif
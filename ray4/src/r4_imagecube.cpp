@@ -0,0 +1,385 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// r4_imagecube.cpp
+//
+// This file contains the implementation of the ImageCube memory-mapped image cube reader. See
+// r4_imagecube.h for more information, and ray4-image-format.md for the image file format.
+//==================================================================================================
+
+#include "r4_imagecube.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+// Constant Definitions
+
+const uint64_t headerSize_1 = 24;  // Version 1 Header Size in Bytes
+const uint64_t headerSize_2 = 14;  // Version 2 Header Size in Bytes, Excluding Background Pixel
+
+
+
+//__________________________________________________________________________________________________
+
+static uint16_t getUInt16 (const uint8_t *bytes) {
+    // Returns the big-endian 16-bit value at the given address.
+    return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+}
+
+//__________________________________________________________________________________________________
+
+static uint32_t getUInt32 (const uint8_t *bytes) {
+    // Returns the big-endian 32-bit value at the given address.
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+//__________________________________________________________________________________________________
+
+ImageCube::~ImageCube () {
+    close();
+}
+
+//__________________________________________________________________________________________________
+
+void ImageCube::close () {
+    // Unmaps the image cube file, if any.
+
+  #if defined(_WIN32)
+    if (data)    UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file)    CloseHandle(file);
+    mapping = nullptr;
+    file    = nullptr;
+  #else
+    if (data)
+        munmap(const_cast<uint8_t*>(data), size);
+  #endif
+
+    data = nullptr;
+    size = 0;
+    info = ImageCubeHeader();
+    planeStart.clear();
+}
+
+//__________________________________________________________________________________________________
+
+bool ImageCube::open (const std::filesystem::path& fileName, std::string &errorMessage) {
+    close();
+
+    // Map the entire file read-only. Pages are only loaded from disk as they are touched.
+
+  #if defined(_WIN32)
+    file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = nullptr;
+        errorMessage = "could not be opened";
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        errorMessage = "is empty or unreadable";
+        close();
+        return false;
+    }
+    size = static_cast<uint64_t>(fileSize.QuadPart);
+
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping)
+        data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  #else
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        errorMessage = "could not be opened";
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        ::close(fd);
+        errorMessage = "is empty or unreadable";
+        return false;
+    }
+    size = static_cast<uint64_t>(fileStat.st_size);
+
+    void *address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps its own reference to the file.
+    if (address != MAP_FAILED)
+        data = static_cast<const uint8_t*>(address);
+  #endif
+
+    if (!data) {
+        errorMessage = "could not be mapped into memory";
+        close();
+        return false;
+    }
+
+    // Read the image header.
+
+    if (size < 5 || getUInt32(data) != ray4FormatMagic) {
+        errorMessage = "is not a valid ray4 image file";
+        close();
+        return false;
+    }
+
+    info.version = data[4];
+
+    if (info.version == 1) {
+        if (size < headerSize_1) {
+            errorMessage = "has a truncated header";
+            close();
+            return false;
+        }
+
+        info.bitsPerPixel = data[5];
+
+        for (auto i = 0;  i < 3;  ++i) {
+            info.aspect[i] = getUInt16(data +  6 + 2*i);
+            info.start[i]  = getUInt16(data + 12 + 2*i);
+            info.end[i]    = getUInt16(data + 18 + 2*i);
+            info.resolution[i] = 1 + info.end[i] - info.start[i];
+        }
+
+        dataStart = headerSize_1;
+
+    } else if (info.version == 2) {
+        if (size < headerSize_2 + 3) {
+            errorMessage = "has a truncated header";
+            close();
+            return false;
+        }
+
+        info.pixelType    = data[5];
+        info.bitsPerPixel = getUInt16(data + 6);
+
+        for (auto i = 0;  i < 3;  ++i) {
+            info.resolution[i] = getUInt16(data + 8 + 2*i);
+            info.end[i] = info.resolution[i] - 1;
+        }
+
+        memcpy (info.background, data + headerSize_2, 3);
+        dataStart = headerSize_2 + 3;
+
+    } else {
+        errorMessage = "is an unsupported version (" + std::to_string(info.version) + ")";
+        close();
+        return false;
+    }
+
+    // Validate the header values.
+
+    if (info.pixelType != pixelTypeRGB || info.bitsPerPixel != 24) {
+        errorMessage = "has an unsupported bits per pixel (" + std::to_string(info.bitsPerPixel) + ")";
+        close();
+        return false;
+    }
+
+    if (info.aspect[0] != 1 || info.aspect[1] != 1 || info.aspect[2] != 1) {
+        errorMessage = "has aspect ratio " + std::to_string(info.aspect[0]) + ':'
+                     + std::to_string(info.aspect[1]) + ':' + std::to_string(info.aspect[2])
+                     + ". Only 1:1:1 is supported";
+        close();
+        return false;
+    }
+
+    if (info.resolution[0] < 1 || info.resolution[1] < 1 || info.resolution[2] < 1) {
+        errorMessage = "has invalid start/end values";
+        close();
+        return false;
+    }
+
+    if (info.version == 1) {
+        if (size < dataStart + planeSize() * depth()) {
+            errorMessage = "is truncated";
+            close();
+            return false;
+        }
+    } else if (!indexPlanes(errorMessage)) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+bool ImageCube::indexPlanes (std::string &errorMessage) {
+    // Finds the start of each plane of a version 2 image file, validating the encoded image data
+    // along the way. Only the plane and line flags and the span counts are read; pixel data is
+    // skipped over.
+
+    uint64_t offset = dataStart;
+
+    auto fail = [&](int z) {
+        errorMessage = "has invalid or truncated image data in plane " + std::to_string(z);
+        return false;
+    };
+
+    planeStart.resize(depth());
+
+    for (auto z = 0;  z < depth();  ++z) {
+        planeStart[z] = offset;
+
+        if (offset >= size)
+            return fail(z);
+
+        auto planeFlag = data[offset++];
+
+        if (planeFlag == planeBackground)
+            continue;
+
+        if (planeFlag != planeRegular)
+            return fail(z);
+
+        for (auto y = 0;  y < height();  ++y) {
+            if (offset >= size)
+                return fail(z);
+
+            switch (data[offset++]) {
+                case lineBackground:
+                    break;
+
+                case lineRegular:
+                    offset += lineSize();
+                    break;
+
+                case lineSpans:
+                    for (auto x = 0;  x < width();  ) {
+                        if (size - offset < 4)
+                            return fail(z);
+
+                        int bgCount    = getUInt16(data + offset);
+                        int pixelCount = getUInt16(data + offset + 2);
+
+                        if (width() - x < bgCount + pixelCount)
+                            return fail(z);
+
+                        offset += 4 + 3 * static_cast<uint64_t>(pixelCount);
+                        x += bgCount + pixelCount;
+                    }
+                    break;
+
+                default:
+                    return fail(z);
+            }
+
+            if (offset > size)
+                return fail(z);
+        }
+    }
+
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+const uint8_t* ImageCube::plane (int z) const {
+    if (info.version != 1 || z < 0 || depth() <= z)
+        return nullptr;
+
+    return data + dataStart + planeSize() * z;
+}
+
+//__________________________________________________________________________________________________
+
+const uint8_t* ImageCube::line (int z, int y) const {
+    auto planeData = plane(z);
+
+    if (!planeData || y < 0 || height() <= y)
+        return nullptr;
+
+    return planeData + lineSize() * y;
+}
+
+//__________________________________________________________________________________________________
+
+bool ImageCube::readPlane (int z, uint8_t *buffer) const {
+    if (z < 0 || depth() <= z)
+        return false;
+
+    if (info.version == 1) {
+        memcpy (buffer, plane(z), planeSize());
+        return true;
+    }
+
+    // Decode the version 2 plane. The encoded data was validated when the planes were indexed.
+
+    auto fillBackground = [&](uint8_t *pixels, int count) {
+        for (auto i = 0;  i < count;  ++i) {
+            *pixels++ = info.background[0];
+            *pixels++ = info.background[1];
+            *pixels++ = info.background[2];
+        }
+    };
+
+    auto encoded = data + planeStart[z];
+
+    if (*encoded++ == planeBackground) {
+        fillBackground(buffer, width() * height());
+        return true;
+    }
+
+    for (auto y = 0;  y < height();  ++y) {
+        auto lineData = buffer + lineSize() * y;
+
+        switch (*encoded++) {
+            case lineBackground:
+                fillBackground(lineData, width());
+                break;
+
+            case lineRegular:
+                memcpy (lineData, encoded, lineSize());
+                encoded += lineSize();
+                break;
+
+            case lineSpans:
+                for (auto x = 0;  x < width();  ) {
+                    int bgCount    = getUInt16(encoded);
+                    int pixelCount = getUInt16(encoded + 2);
+                    encoded += 4;
+
+                    fillBackground(lineData + 3*x, bgCount);
+                    x += bgCount;
+
+                    memcpy (lineData + 3*x, encoded, 3 * static_cast<size_t>(pixelCount));
+                    encoded += 3 * static_cast<size_t>(pixelCount);
+                    x += pixelCount;
+                }
+                break;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,110 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+#ifndef R4_IMAGECUBE_H
+#define R4_IMAGECUBE_H
+
+//==================================================================================================
+// r4_imagecube.h
+//
+// A read-only, memory-mapped view of a ray4 image cube file. The file is mapped into memory rather
+// than read, so only the pages that are actually touched are loaded. Planes and lines of version 1
+// image files are returned as direct views into the mapping; version 2 planes are decoded on
+// request. All file offsets are 64-bit, so image cubes may be arbitrarily large.
+//==================================================================================================
+
+#include "r4_image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+
+//__________________________________________________________________________________________________
+
+struct ImageCubeHeader {
+    // The image cube description read from either version of the image file header. Fields that
+    // don't appear in a given version are set to their implied values.
+
+    int     version{0};            // Image File Version Number
+    int     pixelType{0};          // Pixel Type
+    int     bitsPerPixel{0};       // Number of Bits per Pixel
+    int     aspect[3]{1, 1, 1};    // Aspect Ratios [X,Y,Z]
+    int     start[3]{0, 0, 0};     // Starting Image Pixels for [X,Y,Z]
+    int     end[3]{0, 0, 0};       // Ending Image Pixels for [X,Y,Z]
+    int     resolution[3]{0,0,0};  // Effective Image Resolution
+    uint8_t background[3]{};       // Background Pixel (Version 2)
+};
+
+//__________________________________________________________________________________________________
+
+class ImageCube {
+    // A memory-mapped image cube file. Only 24-bit RGB image cubes are supported. Once opened, an
+    // image cube may be read concurrently from any number of threads.
+
+  public:
+    ImageCube() = default;
+    ~ImageCube();
+
+    ImageCube(const ImageCube&) = delete;
+    ImageCube& operator= (const ImageCube&) = delete;
+
+    // Maps the given image cube file and reads its header. For version 2 files, this also indexes
+    // the start of every plane. On failure, returns false with a description in errorMessage.
+    bool open(const std::filesystem::path& fileName, std::string &errorMessage);
+
+    const ImageCubeHeader& header() const { return info; }
+
+    int width()  const { return info.resolution[0]; }
+    int height() const { return info.resolution[1]; }
+    int depth()  const { return info.resolution[2]; }
+
+    size_t lineSize()  const { return 3 * static_cast<size_t>(width()); }
+    size_t planeSize() const { return lineSize() * height(); }
+
+    // Returns a direct view of the given plane or pixel line in the mapped file, or null if the
+    // image data is encoded (version 2) or the index is out of range.
+    const uint8_t* plane(int z) const;
+    const uint8_t* line(int z, int y) const;
+
+    // Copies or decodes the given plane into the buffer, which must hold planeSize() bytes. Returns
+    // false if the plane index is out of range.
+    bool readPlane(int z, uint8_t *buffer) const;
+
+  private:
+    bool indexPlanes(std::string &errorMessage);
+    void close();
+
+    ImageCubeHeader       info;                 // Image Header
+    const uint8_t        *data     { nullptr }; // Mapped File Data
+    uint64_t              size     { 0 };       // Mapped File Size
+    uint64_t              dataStart{ 0 };       // File Offset of First Image Plane
+    std::vector<uint64_t> planeStart;           // File Offset of Each Plane (Version 2)
+
+  #if defined(_WIN32)
+    void                 *file     { nullptr }; // File Handle
+    void                 *mapping  { nullptr }; // File Mapping Handle
+  #endif
+};
+
+#endif
@@ -30,12 +30,16 @@
 #include <fcntl.h>
 
 #include "ray4.h"
+#include "r4_writer.h"
 
 
     /***  Local Global Variables  ***/
 
-FILE *instream  = nullptr;  // Input Stream
-FILE *outstream = nullptr;  // Output Stream
+FILE        *instream    = nullptr;  // Input Stream
+FILE        *outstream   = nullptr;  // Output Stream
+AsyncWriter *outwriter   = nullptr;  // Output Stream Writer (null -> Synchronous Writes)
+double       outstall    = 0.0;      // Time Stalled on a Closed Output Writer, in Seconds
+uint64_t     outbytes    = 0;        // Number of Bytes Written to the Output Stream
 
 
 
@@ -53,7 +57,13 @@ void CloseInput () {
 //__________________________________________________________________________________________________
 
 void CloseOutput () {
-    // Closes the output stream.
+    // Closes the output stream, after writing any pending output.
+
+    if (outwriter) {
+        outstall = outwriter->stallSeconds();
+        delete outwriter;
+        outwriter = nullptr;
+    }
 
     if (!outstream)
         return;
@@ -63,6 +73,32 @@ void CloseOutput () {
 
 //__________________________________________________________________________________________________
 
+void FlushOutput () {
+    // Waits until all output so far has been written to the output file.
+
+    if (outwriter ? !outwriter->flush() : (fflush(outstream) != 0))
+        Halt ("Write error to output file; aborting");
+}
+
+//__________________________________________________________________________________________________
+
+double OutputStallTime () {
+    // Returns the total time, in seconds, that the tracer has waited for output buffers to be
+    // written.
+
+    return outwriter ? outwriter->stallSeconds() : outstall;
+}
+
+//__________________________________________________________________________________________________
+
+uint64_t OutputBytesWritten () {
+    // Returns the total number of bytes written to the output file so far.
+
+    return outbytes;
+}
+
+//__________________________________________________________________________________________________
+
 const int UNREAD_NONE = -2;
 static int unreadChar = UNREAD_NONE;
 
@@ -100,12 +136,20 @@ void OpenInput (const char* fileName) {
 
 //__________________________________________________________________________________________________
 
-void OpenOutput (const char* fileName) {
-    // This subroutine opens the output file.
+void OpenOutput (
+    const char *fileName,     // Output File Name
+    int         bufferCount,  // Number of Output Buffers (0 -> Synchronous Writes)
+    size_t      bufferSize)   // Size of Each Output Buffer in Bytes
+{
+    // This subroutine opens the output file. If bufferCount is non-zero, then output is collected
+    // in a ring of buffers that are written to the file on a background thread.
 
     outstream = fopen (fileName, "wb");
     if (!outstream)
         Halt ("Open failed on output file (%s).", fileName);
+
+    if (bufferCount > 0)
+        outwriter = new AsyncWriter (outstream, bufferCount, bufferSize);
 }
 
 //__________________________________________________________________________________________________
@@ -116,6 +160,8 @@ void WriteBlock (
 {
     // This routine writes a block to the output file.
 
-    if (num != fwrite (buff, 1, num, outstream))
+    if (outwriter ? !outwriter->write(buff, num) : (num != fwrite (buff, 1, num, outstream)))
         Halt ("Write error to output file; aborting");
+
+    outbytes += num;
 }
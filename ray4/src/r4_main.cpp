@@ -25,7 +25,10 @@
 // This file contains the main procedures in the Ray4 4D ray tracer.
 //==================================================================================================
 
+#include "r4_arena.h"
 #include "r4_image.h"
+#include "r4_pool.h"
+#include "r4_process.h"
 
 #define  DEFINE_GLOBALS
 #include "ray4.h"
@@ -33,7 +36,10 @@
 #include <time.h>
 #include <stdarg.h>
 
+#include <algorithm>
+#include <chrono>
 #include <codecvt>
+#include <mutex>
 #include <vector>
 
 using ImageHeader = ImageHeader_1;
@@ -51,7 +57,17 @@ usage:  ray4 [-h|/?|--help] [-v|--version]
              [-o|--output|--image <Image File Name>]
              [-r|--resolution <Image Resolution>]
              [-b|--bitsPerPixel <Bits Per Pixel>]
+             [-f|--format <Image File Version>]
              [-s|--slice <Slice Plane>]
+             [-t|--threads <Thread Count>]
+             [-p|--packetSize <Ray Count>]
+             [-P|--precision double|float]
+             [-a|--accel bvh|grid|list]
+             [-g|--gbuffer <Cache File Name>]
+             [-m|--minWeight <Ray Weight>]
+             [-A|--adaptive <Cell Size>[:<Tolerance>]]
+             [-w|--writeBuffers <Buffer Count>[:<Buffer Size>]]
+             [-j|--stats-json <Statistics File Name>]
 
 This program constructs a 4D raytraced image of the input scene file, outputing
 a 3D image cube of pixels.
@@ -81,11 +97,95 @@ options may override those in the environment variable.
     The output number of RGB bits per pixel. This value must be either 12 or 24.
     By default, there are 24 bits per pixel.
 
+-f, --format <Image File Version>
+    The output image file format version, either 1 or 2. Version 1 image files
+    hold raw scanlines. Version 2 image files are run-length encoded, so that
+    planes, lines and spans of background pixels take almost no space. Version
+    2 requires 24 bits per pixel. By default, version 1 image files are written.
+    See ray4-image-format.md for details.
+
 -s, --slice <Slice Plane>
     By default, all image planes in the full Z resolution are traced. This
     option allows you to specify a single plane to output. For example, if the
     Z resolution is 100, then any value in the range [0, 99] is acceptable.
 
+-t, --threads <Thread Count>
+    The number of threads used to trace the image. The image cube is split into
+    tiles that are traced in parallel. A value of zero uses one thread for each
+    processor. By default, the image is traced on a single thread. The output
+    image is identical for any number of threads.
+
+-p, --packetSize <Ray Count>
+    Primary rays are traced in packets of adjacent rays along the X axis, which
+    share the work of finding the objects they hit. The packet size may be 1
+    (no packets), 4 or 8. By default, rays are traced in packets of 8. The
+    output image is identical for any packet size.
+
+-P, --precision double|float
+    The floating-point precision of the ray intersection tests for spheres,
+    tetrahedrons and parallelepipeds. Single precision halves the memory
+    traffic of these tests, for faster preview renders of large scenes, at the
+    cost of small differences along object edges. Shading is always computed
+    in double precision. By default, intersections use double precision.
+
+-a, --accel bvh|grid|list
+    The structure used to find the objects that each ray hits. 'bvh' is a
+    bounding volume hierarchy, which suits most scenes. 'grid' is a uniform 4D
+    grid of cells, which can be faster for dense scenes of many similarly sized
+    objects. 'list' tests every ray against every object. The grid and list
+    test objects one ray at a time in double precision. The output image is
+    identical for every accelerator. By default, the hierarchy is used.
+
+-g, --gbuffer <Cache File Name>
+    Cache the nearest intersection of every primary ray in the given file. If
+    the file holds the intersections for the same scene geometry, view and
+    resolution, they are read back instead of tracing the primary rays, so
+    that re-rendering a view with different lights or attributes only shades
+    the image. Otherwise the file is rewritten with the intersections of this
+    render. The cache file takes 72 bytes per pixel, and is only meant for the
+    machine that wrote it. The output image is identical with or without the
+    cache.
+
+-m, --minWeight <Ray Weight>
+    Skip reflection and refraction rays whose contribution to the pixel color
+    is below the given weight. The weight of a ray is the product of the
+    reflection or refraction coefficients along its path from the eye, and a
+    ray is pruned when all of its color components fall below the minimum. The
+    weight may be given as a decimal or a fraction, such as 1/512. Small
+    weights give large speedups in deeply reflective or transparent scenes
+    with only slight changes to the image, and larger weights trade more image
+    accuracy for speed. The number of pruned rays is reported on completion.
+    By default, the minimum weight is zero, and every ray is traced.
+
+-A, --adaptive <Cell Size>[:<Tolerance>]
+    Trace the image cube by adaptive subdivision instead of tracing every
+    pixel. The cube is split into cells of the given size, from 2 to 16 pixels
+    on a side, and the pixels at the corners of each cell are traced. A cell
+    whose corners all see the same object with colors that differ by no more
+    than the tolerance is filled by interpolating the corner colors. Other
+    cells are split in half along each axis and handled the same way. The
+    tolerance is the largest difference of a color component in [0,1], and is
+    0.03 by default. Features smaller than a cell, such as a highlight or a
+    thin shadow within an otherwise smooth region, may be lost, so this mode is
+    meant for fast previews; use the ray4_bench --adaptive option to measure
+    its speed and error against a full trace. This mode can't be used with a
+    G-buffer cache. By default, every pixel is traced.
+
+-w, --writeBuffers <Buffer Count>[:<Buffer Size>]
+    The output image is written on a background thread through a ring of
+    buffers, so that tracing continues while completed image planes are written
+    to disk. This option sets the number of buffers and the size of each buffer
+    in megabytes. A buffer count of zero writes the output synchronously. By
+    default, there are 3 buffers of 4 megabytes each. The time that tracing
+    stalled waiting for output to be written is reported on completion.
+
+-j, --stats-json <Statistics File Name>
+    Write a machine-readable JSON report of the render to the given file on
+    completion. The report holds the image resolution, the object and light
+    counts, the wall-clock and processor time of each phase, the rays traced
+    per second, the peak memory use, the number of bytes written and the trace
+    thread utilization.
+
 Examples:
     ray4 -r 128:128:128 -i scene.r4 -o scene.icube
 
@@ -93,6 +193,26 @@ Examples:
 
     ray4 --resolution 1024:768 --slice 1023 --scene Sphere4 --image s2.icube
 
+    ray4 --threads 0 -r 512 -i scene.r4 -o scene.icube
+
+    ray4 --format 2 -r 256 -i scene.r4 -o scene.icube
+
+    ray4 --packetSize 4 -r 256 -i scene.r4 -o scene.icube
+
+    ray4 --precision float -r 256 -i scene.r4 -o preview.icube
+
+    ray4 --accel grid -r 256 -i dots.r4 -o dots.icube
+
+    ray4 --gbuffer scene.gbuf -r 256 -i scene.r4 -o scene.icube
+
+    ray4 --minWeight 1/512 -r 256 -i mirrors.r4 -o mirrors.icube
+
+    ray4 --adaptive 8:0.02 -r 256 -i scene.r4 -o preview.icube
+
+    ray4 --writeBuffers 4:64 -r 1024 -i scene.r4 -o scene.icube
+
+    ray4 --stats-json render.json -r 256 -i scene.r4 -o scene.icube
+
 )";
 
 //__________________________________________________________________________________________________
@@ -104,8 +224,20 @@ struct Parameters {
     wstring sceneFileName   { };             // Input Ray4 Scene File Name
     wstring imageFileName   { };             // Output Image File Name
     int     bitsPerPixel    { 24 };          // Number of Bits Per Pixel
+    int     imageVersion    { 1 };           // Image File Format Version
     int     resolution[3]   { -1, -1, -1 };  // Output Image Resolution
     int     slice           { -1 };          // Image Slice Plane (-1 -> all)
+    int     threads         { 1 };           // Number of Trace Threads (0 -> all processors)
+    int     packetSize      { MAX_PACKET };  // Number of Primary Rays per Ray Packet
+    bool    singlePrecision { false };       // Single-Precision Intersection Tests
+    Accel   accel           { Accel::BVH };  // Ray Intersection Accelerator
+    int     writeBuffers    { 3 };           // Number of Output Buffers (0 -> synchronous)
+    int     writeBufferSize { 4 };           // Size of Each Output Buffer in Megabytes
+    wstring statsFileName   { };             // Statistics Report File Name (Empty -> None)
+    wstring gbufferFileName { };             // G-Buffer Cache File Name (Empty -> None)
+    double  minWeight       { 0.0 };         // Minimum Weight of Secondary Rays (0 -> all)
+    int     cellSize        { 0 };           // Adaptive Subdivision Cell Size (0 -> off)
+    double  cellTolerance   { 0.03 };        // Adaptive Subdivision Color Tolerance
 };
 
 enum class OptionType {
@@ -115,7 +247,17 @@ enum class OptionType {
     ImageFileName,
     Resolution,
     BitsPerPixel,
+    Format,
     Slice,
+    Threads,
+    PacketSize,
+    Precision,
+    Accel,
+    WriteBuffers,
+    StatsJson,
+    GBuffer,
+    MinWeight,
+    Adaptive,
     Unrecognized,
 };
 
@@ -139,7 +281,17 @@ static vector<OptionInfo> optionInfo = {
     {OptionType::ImageFileName,  L"-o", L"--image",        true},
     {OptionType::Resolution,     L"-r", L"--resolution",   true},
     {OptionType::BitsPerPixel,   L"-b", L"--bitsPerPixel", true},
+    {OptionType::Format,         L"-f", L"--format",       true},
     {OptionType::Slice,          L"-s", L"--slice",        true},
+    {OptionType::Threads,        L"-t", L"--threads",      true},
+    {OptionType::PacketSize,     L"-p", L"--packetSize",   true},
+    {OptionType::Precision,      L"-P", L"--precision",    true},
+    {OptionType::Accel,          L"-a", L"--accel",        true},
+    {OptionType::WriteBuffers,   L"-w", L"--writeBuffers", true},
+    {OptionType::StatsJson,      L"-j", L"--stats-json",   true},
+    {OptionType::GBuffer,        L"-g", L"--gbuffer",      true},
+    {OptionType::MinWeight,      L"-m", L"--minWeight",    true},
+    {OptionType::Adaptive,       L"-A", L"--adaptive",     true},
 };
 
 //__________________________________________________________________________________________________
@@ -148,6 +300,10 @@ static vector<OptionInfo> optionInfo = {
 #define MIN_SLB_COUNT 5        // Minimum Scanline Buffer Count
 #define MIN_SLB_SIZE  (5<<10)  // Minimum Scanline Buffer Size
 
+#define TILE_XSIZE 16  // Ray-Grid Tile Width in Voxels
+#define TILE_YSIZE 16  // Ray-Grid Tile Height in Voxels
+#define TILE_ZSIZE  4  // Ray-Grid Tile Depth in Voxels (Image Planes per Slab)
+
 
 // File-Global Variables
 
@@ -157,17 +313,59 @@ long     scanlsize;         // Scanline Size
 long     slbuff_count;      // Number of Lines in Scanline Buffer
 char    *scanbuff;          // Scanline Buffer
 time_t   StartTime;         // Timestamp
+Arena    sceneArena;        // Scene Memory (Objects, Attributes, Lights, Buffers)
+
+
+// Program Phases, Timed for the Final Statistics
+
+enum class Phase { Parse, Build, Grid, Trace, Write, Count };
+
+static const char *phaseNames[] {    // Phase Names for the Final Statistics
+    "Parse time", "Hierarchy build time", "Ray grid setup time", "Trace time", "Write time"
+};
+
+static const char *phaseKeys[] {     // Phase Names for the JSON Statistics Report
+    "parse", "build", "grid", "trace", "write"
+};
+
+static long long phaseTime[static_cast<int>(Phase::Count)];  // Phase Times in Nanoseconds
+static double    phaseCpu[static_cast<int>(Phase::Count)];   // Phase Processor Times in Seconds
+
+class PhaseTimer {
+    // Adds the wall-clock time and process processor time from construction to destruction to the
+    // given program phase.
+
+  public:
+    explicit PhaseTimer (Phase phase)
+      : phase(phase), start(std::chrono::steady_clock::now()), cpuStart(processCpuSeconds()) {}
+
+    ~PhaseTimer () {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        phaseTime[static_cast<int>(phase)] +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        phaseCpu[static_cast<int>(phase)] += processCpuSeconds() - cpuStart;
+    }
+
+  private:
+    Phase                                 phase;     // Timed Phase
+    std::chrono::steady_clock::time_point start;     // Start Time
+    double                                cpuStart;  // Process Processor Time at Start
+};
+
+static std::chrono::steady_clock::time_point programStart;  // Program Start Time
+static int traceThreads { 1 };                               // Number of Trace Threads
+static GBufferMode gbufferMode { GBufferMode::None };        // G-Buffer Cache File Mode
 
 
 //__________________________________________________________________________________________________
 
-char *MyAlloc (size_t size) {
-    // This routine allocates memory using the system malloc() function. If the malloc() call fails
-    // to allocate the memory, this routine halts the program with an "out of memory" message.
+char *MyAlloc (size_t size, size_t alignment) {
+    // This routine allocates memory from the scene arena. If the allocation fails, this routine
+    // halts the program with an "out of memory" message.
 
     char *block;  // Allocated Memory Block
 
-    if (0 == (block = static_cast<char*>(malloc (size))))
+    if (0 == (block = static_cast<char*>(sceneArena.allocate (size, alignment))))
         Halt ("Out of memory.");
 
     return block;
@@ -175,12 +373,6 @@ char *MyAlloc (size_t size) {
 
 //__________________________________________________________________________________________________
 
-void MyFree (void *addr) {
-    free (addr);
-}
-
-//__________________________________________________________________________________________________
-
 void Halt (const char *message, ...) {
     // This procedure replaces printf() to print out an error message, and has the side effect of
     // cleaning up before exiting (de-allocating memory, closing open files, and so on).
@@ -202,35 +394,63 @@ void Halt (const char *message, ...) {
     CloseInput ();
     CloseOutput();
 
-    if (scanbuff)
-        DELETE (scanbuff);
+    // Free the light, object and attribute lists and the scanline buffer in one go by releasing the
+    // scene arena.
 
-    Light *lptr;  // Light-List Pointer
-    while ((lptr = lightlist)) {          // Free the lightsource list.
-        lightlist = lightlist->next;
-        DELETE (lptr);
-    }
+    const auto arena = sceneArena.stats();
 
-    ObjInfo *optr;  // Object-List Pointer
-    while ((optr = objlist)) {            // Free the object list.
-        objlist = objlist->next;
-        DELETE (optr);
-    }
-
-    Attributes *aptr;  // Attributes-List Pointer
-    while ((aptr = attrlist)) {           // Free the attribute list.
-        attrlist = attrlist->next;
-        DELETE (aptr);
-    }
+    scanbuff  = nullptr;
+    lightlist = nullptr;
+    objlist   = nullptr;
+    attrlist  = nullptr;
+    sceneArena.release();
 
     if (!message) {
         long  elapsed, hours, minutes, seconds;
 
+        static const char *typeNames[OBJ_TYPE_COUNT] {  // Object Type Names
+            nullptr, "Sphere", "Tetrahedron", "Triangle", "Parallelepiped"
+        };
+
         print  ("\n");
-        printf ("       Total rays cast:  %lu\n", stats.Ncast);
-        printf ("  Reflection rays cast:  %lu\n", stats.Nreflect);
-        printf ("  Refraction rays cast:  %lu\n", stats.Nrefract);
-        printf ("Maximum raytrace level:  %lu\n", stats.maxlevel);
+        printf ("       Total rays cast:  %lld\n", stats.Ncast);
+        printf ("     Primary rays cast:  %lld\n", stats.Nprimary);
+        printf ("  Reflection rays cast:  %lld\n", stats.Nreflect);
+        printf ("  Refraction rays cast:  %lld\n", stats.Nrefract);
+        printf ("      Shadow rays cast:  %lld\n", stats.Nshadow);
+        printf ("           Pruned rays:  %lld\n", stats.Npruned);
+        if (stats.Ninterp)
+            printf ("   Interpolated pixels:  %lld\n", stats.Ninterp);
+        printf ("     Shadow cache hits:  %lld of %lld tests (%.1f%%)\n",
+                stats.shadowCacheHits, stats.shadowCacheTests,
+                stats.shadowCacheTests ? (100.0 * stats.shadowCacheHits / stats.shadowCacheTests)
+                                       : 0.0);
+        printf ("Maximum raytrace level:  %lld\n", stats.maxlevel);
+
+        for (auto level = 1;  level <= STATS_LEVELS;  ++level) {
+            if (stats.levelRays[level - 1])
+                printf ("  Rays cast at level %2d:  %lld%s\n", level, stats.levelRays[level - 1],
+                        (level == STATS_LEVELS) ? " (and deeper)" : "");
+        }
+
+        for (auto type = 1;  type < OBJ_TYPE_COUNT;  ++type) {
+            if (stats.tests[type])
+                printf ("%16s tests:  %lld (%lld hits)\n",
+                        typeNames[type], stats.tests[type], stats.hits[type]);
+        }
+
+        for (auto phase = 0;  phase < static_cast<int>(Phase::Count);  ++phase)
+            printf ("%22s:  %.6f seconds\n", phaseNames[phase], 1e-9 * phaseTime[phase]);
+
+        printf ("     Output stall time:  %.3f seconds\n", OutputStallTime());
+        if (gbufferMode != GBufferMode::None)
+            printf ("        G-buffer cache:  primary intersections %s\n",
+                    (gbufferMode == GBufferMode::Read) ? "read" : "written");
+
+        printf ("     Scene arena bytes:  %zu used, %zu reserved in %zu blocks\n",
+                arena.used, arena.reserved, arena.blocks);
+        printf ("   Arena fragmentation:  %.1f%% (%zu bytes of padding)\n",
+                arena.reserved ? (100.0 * arena.padding / arena.reserved) : 0.0, arena.padding);
 
         elapsed = static_cast<long>(time(0) - StartTime);
         hours   = elapsed / 3600;
@@ -415,9 +635,77 @@ bool processParameters (Parameters &params, int argc, wchar_t *argv[]) {
                 params.bitsPerPixel = stoi(optionValue);
                 break;
 
+            case OptionType::Format:
+                params.imageVersion = stoi(optionValue);
+                break;
+
             case OptionType::Slice:
                 params.slice = stoi(optionValue);
                 break;
+
+            case OptionType::Threads:
+                params.threads = stoi(optionValue);
+                break;
+
+            case OptionType::PacketSize:
+                params.packetSize = stoi(optionValue);
+                break;
+
+            case OptionType::Precision:
+                if (optionValue == L"double")
+                    params.singlePrecision = false;
+                else if (optionValue == L"float")
+                    params.singlePrecision = true;
+                else {
+                    wcerr << "ray4: Invalid precision: (" << optionValue << ").\n";
+                    return false;
+                }
+                break;
+
+            case OptionType::Accel:
+                if (optionValue == L"bvh")
+                    params.accel = Accel::BVH;
+                else if (optionValue == L"grid")
+                    params.accel = Accel::Grid;
+                else if (optionValue == L"list")
+                    params.accel = Accel::List;
+                else {
+                    wcerr << "ray4: Invalid accelerator: (" << optionValue << ").\n";
+                    return false;
+                }
+                break;
+
+            case OptionType::WriteBuffers: {
+                auto colon = optionValue.find(L':');
+                params.writeBuffers = stoi(optionValue.substr(0, colon));
+                if (colon != wstring::npos)
+                    params.writeBufferSize = stoi(optionValue.substr(colon + 1));
+                break;
+            }
+
+            case OptionType::StatsJson:
+                params.statsFileName = optionValue;
+                break;
+
+            case OptionType::GBuffer:
+                params.gbufferFileName = optionValue;
+                break;
+
+            case OptionType::MinWeight: {
+                auto slash = optionValue.find(L'/');
+                params.minWeight = stod(optionValue.substr(0, slash));
+                if (slash != wstring::npos)
+                    params.minWeight /= stod(optionValue.substr(slash + 1));
+                break;
+            }
+
+            case OptionType::Adaptive: {
+                auto colon = optionValue.find(L':');
+                params.cellSize = stoi(optionValue.substr(0, colon));
+                if (colon != wstring::npos)
+                    params.cellTolerance = stod(optionValue.substr(colon + 1));
+                break;
+            }
         }
     }
 
@@ -440,6 +728,16 @@ bool processParameters (Parameters &params, int argc, wchar_t *argv[]) {
         return false;
     }
 
+    if (params.imageVersion != 1 && params.imageVersion != 2) {
+        wcerr << "ray4: Invalid image file format version: " << params.imageVersion << ".\n";
+        return false;
+    }
+
+    if (params.imageVersion == 2 && params.bitsPerPixel != 24) {
+        wcerr << "ray4: Version 2 image files require 24 bits per pixel.\n";
+        return false;
+    }
+
     if (params.resolution[0] < 1) {
         wcerr << "ray4: Missing required resolution value(s).\n";
         return false;
@@ -451,6 +749,40 @@ bool processParameters (Parameters &params, int argc, wchar_t *argv[]) {
         return false;
     }
 
+    if (params.threads < 0) {
+        wcerr << "ray4: Invalid thread count: " << params.threads << ".\n";
+        return false;
+    }
+
+    if (params.packetSize != 1 && params.packetSize != 4 && params.packetSize != 8) {
+        wcerr << "ray4: Invalid packet size: " << params.packetSize << ".\n";
+        return false;
+    }
+
+    if (params.writeBuffers < 0 || params.writeBufferSize < 1) {
+        wcerr << "ray4: Invalid write buffers: " << params.writeBuffers << ':'
+              << params.writeBufferSize << ".\n";
+        return false;
+    }
+
+    if (!(params.minWeight >= 0 && params.minWeight <= 1)) {
+        wcerr << "ray4: Invalid minimum ray weight: " << params.minWeight << ".\n";
+        return false;
+    }
+
+    if (params.cellSize != 0) {
+        if (params.cellSize < 2 || params.cellSize > 16 || params.cellTolerance < 0) {
+            wcerr << "ray4: Invalid adaptive subdivision: " << params.cellSize << ':'
+                  << params.cellTolerance << ".\n";
+            return false;
+        }
+
+        if (!params.gbufferFileName.empty()) {
+            wcerr << "ray4: Adaptive subdivision can't be used with a G-buffer cache.\n";
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -482,8 +814,39 @@ void WriteUInteger32(uint32_t value) {
 
 //__________________________________________________________________________________________________
 
+void StorePixel (Color color, uint8_t *pixel) {
+    // Scales the color to 0-255 and stores it as a 24-bit RGB pixel.
+
+    color *= 256.0;
+    color = color.clamp(0.0, 255.0);
+
+    pixel[0] = static_cast<uint8_t>(color.r);
+    pixel[1] = static_cast<uint8_t>(color.g);
+    pixel[2] = static_cast<uint8_t>(color.b);
+}
+
+//__________________________________________________________________________________________________
+
 void WriteHeader(const Parameters& params) {
     WriteUInteger32(ray4FormatMagic);  // 'Ray4' Magic ID
+
+    if (params.imageVersion == 2) {
+        WriteUInteger8(2);             // Ray4 Image File Format Version
+        WriteUInteger8(pixelTypeRGB);
+        WriteUInteger16(params.bitsPerPixel);
+
+        WriteUInteger16(params.resolution[0]);
+        WriteUInteger16(params.resolution[1]);
+        WriteUInteger16((params.slice >= 0) ? 1 : params.resolution[2]);
+
+        // The image data begins with the background pixel.
+
+        uint8_t pixel[3];
+        StorePixel (background, pixel);
+        WriteBlock (pixel, 3);
+        return;
+    }
+
     WriteUInteger8(1);                 // Ray4 Image File Format Version
 
     WriteUInteger8(params.bitsPerPixel);
@@ -554,13 +917,466 @@ void CalcRayGrid (const Parameters& params) {
 
 //__________________________________________________________________________________________________
 
-void FireRays (const Parameters &params) {
-    // This is the main routine that fires the rays through the ray grid and into the 4D scene.
+struct RayTile {
+    // A block of the ray grid that is traced as a single job.
+
+    int xStart, xLimit;  // X Index Range [Start, Limit)
+    int yStart, yLimit;  // Y Index Range [Start, Limit)
+    int zStart, zLimit;  // Z Index Range [Start, Limit)
+};
+
+//__________________________________________________________________________________________________
+
+void TraceTile (
+    const Parameters &params,     // Program Parameters
+    const RayTile    &tile,       // Ray-Grid Tile to Trace
+    int               slabStart,  // First Image Plane of the Slab Buffer
+    uint8_t          *slab,       // Slab Buffer of 24-bit RGB Pixels
+    HitRecord        *slabHits)   // Slab Primary Intersections (Null -> No G-Buffer Cache)
+{
+    // This routine fires the rays of a single ray-grid tile into the 4D scene. The resulting pixels
+    // are stored into the slab buffer, which holds complete image planes starting at slabStart.
+    // With a G-buffer cache, the primary intersections are either read from or saved to the slab
+    // intersection buffer, which is laid out like the slab buffer.
+
+    for (auto zIndex = tile.zStart;  zIndex < tile.zLimit;  ++zIndex) {
+        Point4 zOrigin = Gorigin + (zIndex*Gz);
+        for (auto yIndex = tile.yStart;  yIndex < tile.yLimit;  ++yIndex) {
+            Point4 Yorigin = zOrigin + (yIndex*Gy);
+
+            auto lineIndex = static_cast<size_t>(zIndex - slabStart) * params.resolution[1] + yIndex;
+            auto pixel = slab + 3 * (lineIndex * params.resolution[0] + tile.xStart);
+
+            // Fire the rays along the X axis in packets of adjacent rays.
+
+            for (auto xIndex = tile.xStart;  xIndex < tile.xLimit;  xIndex += params.packetSize) {
+                const int count = std::min(params.packetSize, tile.xLimit - xIndex);
+
+                Ray4  rays[MAX_PACKET];    // Primary Rays
+                Color colors[MAX_PACKET];  // Pixel Colors
+
+                for (auto i = 0;  i < count;  ++i) {
+                    Vector4  dir;     // Ray Direction Vector
+                    Point4   Gpoint;  // Current Grid Point
+                    double   norm;    // Vector Norm Value
+
+                    // Calculate the unit ViewFrom-RayDirection vector.
+
+                    Gpoint = Yorigin + ((xIndex + i)*Gx);
+                    dir = Gpoint - Vfrom;
+                    norm = dir.norm();
+                    dir /= norm;
+
+                    rays[i] = Ray4(Vfrom, dir);
+                }
+
+                // Fire the rays, or shade the cached primary intersections.
+
+                HitRecord *hits = slabHits ? slabHits + (lineIndex * params.resolution[0] + xIndex)
+                                           : nullptr;
+
+                if (hits && gbufferMode == GBufferMode::Read)
+                    ShadePrimary (rays, count, hits, colors);
+                else if (count == 1 && !hits)
+                    RayTrace (rays[0], colors[0], 0, Color(1, 1, 1));
+                else
+                    RayTracePacket (rays, count, colors, hits);
+
+                for (auto i = 0;  i < count;  ++i) {
+                    StorePixel (colors[i], pixel);
+                    pixel += 3;
+                }
+            }
+        }
+    }
+}
+
+//__________________________________________________________________________________________________
+
+class AdaptiveTile {
+    // This class traces a single ray-grid tile by adaptive subdivision. The tile is split into
+    // cells of the adaptive cell size, and the voxels at the corners of each cell are traced. A
+    // cell whose corners all see the same object (or all see the background), with colors that
+    // differ by no more than the tolerance, is filled by trilinear interpolation of its corner
+    // colors. Any other cell is split in half along each axis, and the halves are handled in the
+    // same way, down to cells whose voxels are all corners. Cells never cross the tile boundary,
+    // so the result does not depend on the number of threads.
+
+  public:
+    AdaptiveTile (const RayTile &tile, double tolerance)
+      : tile(tile), tolerance(tolerance),
+        xSize(tile.xLimit - tile.xStart),
+        ySize(tile.yLimit - tile.yStart),
+        zSize(tile.zLimit - tile.zStart),
+        samples(static_cast<size_t>(xSize) * ySize * zSize)
+    {}
+
+    void trace (int cellSize) {
+        // Traces or interpolates every voxel of the tile, starting from cells of the given size.
+        // Neighboring cells share their corner voxels.
+
+        int z0 = 0;
+        do {
+            int y0 = 0;
+            do {
+                int x0 = 0;
+                do {
+                    refine (x0, std::min(x0 + cellSize, xSize - 1),
+                            y0, std::min(y0 + cellSize, ySize - 1),
+                            z0, std::min(z0 + cellSize, zSize - 1));
+                    x0 += cellSize;
+                } while (x0 < xSize - 1);
+                y0 += cellSize;
+            } while (y0 < ySize - 1);
+            z0 += cellSize;
+        } while (z0 < zSize - 1);
+    }
+
+    void store (const Parameters &params, int slabStart, uint8_t *slab) {
+        // Stores the tile voxels into the slab buffer, and counts the interpolated voxels.
+
+        auto sample = samples.begin();
+
+        for (auto z = tile.zStart;  z < tile.zLimit;  ++z) {
+            for (auto y = tile.yStart;  y < tile.yLimit;  ++y) {
+                auto lineIndex = static_cast<size_t>(z - slabStart) * params.resolution[1] + y;
+                auto pixel = slab + 3 * (lineIndex * params.resolution[0] + tile.xStart);
+
+                for (auto x = tile.xStart;  x < tile.xLimit;  ++x, ++sample, pixel += 3) {
+                    StorePixel (sample->color, pixel);
+                    if (sample->state == State::Interpolated)
+                        ++stats.Ninterp;
+                }
+            }
+        }
+    }
+
+  private:
+    enum class State : uint8_t { Empty, Interpolated, Traced };
+
+    struct Sample {
+        Color          color;                    // Voxel Color
+        const ObjInfo *object { nullptr };       // Object Seen by Primary Ray (Null -> Background)
+        State          state  { State::Empty };  // Source of the Voxel Color
+    };
+
+    Sample& sample (int x, int y, int z) {
+        // Returns the given tile voxel, tracing its primary ray if it hasn't been traced yet. The
+        // ray is computed in the same way as in TraceTile(), so traced voxels match a full trace.
+
+        auto &voxel = samples[(static_cast<size_t>(z) * ySize + y) * xSize + x];
+
+        if (voxel.state != State::Traced) {
+            Point4 Gpoint = Gorigin + ((tile.zStart + z)*Gz) + ((tile.yStart + y)*Gy)
+                          + ((tile.xStart + x)*Gx);
+            Vector4 dir = Gpoint - Vfrom;
+            dir /= dir.norm();
+
+            Ray4      ray (Vfrom, dir);  // Primary Ray
+            HitRecord hit;               // Nearest Intersection of the Primary Ray
+
+            RayTracePacket (&ray, 1, &voxel.color, &hit);
+            voxel.object = hit.object;
+            voxel.state  = State::Traced;
+        }
+
+        return voxel;
+    }
+
+    void refine (int x0, int x1, int y0, int y1, int z0, int z1) {
+        // Traces the corners of the cell spanning the given inclusive voxel ranges, and then either
+        // interpolates the cell or splits it.
+
+        const int xs[2] { x0, x1 };
+        const int ys[2] { y0, y1 };
+        const int zs[2] { z0, z1 };
+
+        const Sample *corners[8];  // Cell Corners, X Varying Fastest
+
+        for (auto i = 0;  i < 8;  ++i)
+            corners[i] = &sample (xs[i & 1], ys[(i >> 1) & 1], zs[i >> 2]);
+
+        if (x1 - x0 <= 1 && y1 - y0 <= 1 && z1 - z0 <= 1)
+            return;
+
+        if (isUniform (corners)) {
+            interpolate (corners, x0, x1, y0, y1, z0, z1);
+            return;
+        }
+
+        // Split each axis longer than one voxel at its midpoint. The halves share the middle voxel.
+
+        const int xm = (x0 + x1) / 2;
+        const int ym = (y0 + y1) / 2;
+        const int zm = (z0 + z1) / 2;
+
+        const int xSplits[3] { x0, (x1 - x0 > 1) ? xm : x1, x1 };
+        const int ySplits[3] { y0, (y1 - y0 > 1) ? ym : y1, y1 };
+        const int zSplits[3] { z0, (z1 - z0 > 1) ? zm : z1, z1 };
+
+        for (auto k = 0;  k < ((z1 - z0 > 1) ? 2 : 1);  ++k)
+            for (auto j = 0;  j < ((y1 - y0 > 1) ? 2 : 1);  ++j)
+                for (auto i = 0;  i < ((x1 - x0 > 1) ? 2 : 1);  ++i)
+                    refine (xSplits[i], (x1 - x0 > 1) ? xSplits[i+1] : x1,
+                            ySplits[j], (y1 - y0 > 1) ? ySplits[j+1] : y1,
+                            zSplits[k], (z1 - z0 > 1) ? zSplits[k+1] : z1);
+    }
+
+    bool isUniform (const Sample *corners[8]) const {
+        // Returns true if all cell corners see the same object, with colors within the tolerance.
+
+        Color low  = corners[0]->color;
+        Color high = corners[0]->color;
+
+        for (auto i = 1;  i < 8;  ++i) {
+            if (corners[i]->object != corners[0]->object)
+                return false;
+
+            const auto &color = corners[i]->color;
+            low.r  = std::min(low.r, color.r);
+            low.g  = std::min(low.g, color.g);
+            low.b  = std::min(low.b, color.b);
+            high.r = std::max(high.r, color.r);
+            high.g = std::max(high.g, color.g);
+            high.b = std::max(high.b, color.b);
+        }
+
+        return std::max({ high.r - low.r, high.g - low.g, high.b - low.b }) <= tolerance;
+    }
+
+    static Color lerp (const Color &a, const Color &b, double t) {
+        // Returns the linear interpolation from color a (t = 0) to color b (t = 1).
+        return { a.r + t*(b.r - a.r), a.g + t*(b.g - a.g), a.b + t*(b.b - a.b) };
+    }
+
+    void interpolate (const Sample *corners[8], int x0, int x1, int y0, int y1, int z0, int z1) {
+        // Fills the voxels of the cell that haven't been traced or interpolated yet with the
+        // trilinear interpolation of the corner colors. Each line of voxels along X interpolates
+        // between the colors at its two ends, which are interpolated from the cell corners.
+
+        for (auto z = z0;  z <= z1;  ++z) {
+            const double tz = (z1 > z0) ? double(z - z0) / (z1 - z0) : 0.0;
+
+            for (auto y = y0;  y <= y1;  ++y) {
+                const double ty = (y1 > y0) ? double(y - y0) / (y1 - y0) : 0.0;
+
+                Color ends[2];  // Line Colors at x0 and x1
+
+                for (auto e = 0;  e < 2;  ++e)
+                    ends[e] = lerp (lerp (corners[e]->color,   corners[e+2]->color, ty),
+                                    lerp (corners[e+4]->color, corners[e+6]->color, ty), tz);
+
+                auto voxel = samples.begin() + ((static_cast<size_t>(z) * ySize + y) * xSize + x0);
+
+                for (auto x = x0;  x <= x1;  ++x, ++voxel) {
+                    if (voxel->state != State::Empty)
+                        continue;
+
+                    const double tx = (x1 > x0) ? double(x - x0) / (x1 - x0) : 0.0;
+
+                    voxel->color  = lerp (ends[0], ends[1], tx);
+                    voxel->object = corners[0]->object;
+                    voxel->state  = State::Interpolated;
+                }
+            }
+        }
+    }
+
+    const RayTile &tile;                 // Ray-Grid Tile
+    const double   tolerance;            // Largest Color Difference Across an Interpolated Cell
+    const int      xSize, ySize, zSize;  // Tile Size in Voxels
+    vector<Sample> samples;              // Tile Voxels, X Varying Fastest
+};
+
+//__________________________________________________________________________________________________
+
+void WriteSlab (
+    const Parameters &params,      // Program Parameters
+    const uint8_t    *slab,        // Slab Buffer of 24-bit RGB Pixels
+    int               planeCount)  // Number of Image Planes in the Slab
+{
+    // This routine writes the image planes of the slab buffer to the output file, one scanline at a
+    // time, in the output bits per pixel.
 
     long   scancount = 0;       // Scanline Counter
     char  *scanptr = scanbuff;  // Scanline Buffer Pointer
     bool   eflag   = true;      // Even RGB Boundary Flag
 
+    const auto lineCount = planeCount * params.resolution[1];
+
+    for (auto line = 0;  line < lineCount;  ++line) {
+        if (!eflag) {
+            ++scanptr;
+            eflag = true;
+        }
+
+        for (auto xIndex = 0;  xIndex < params.resolution[0];  ++xIndex) {
+            uint8_t r = *slab++;
+            uint8_t g = *slab++;
+            uint8_t b = *slab++;
+
+            // Store the RGB triple in the scanline buffer.
+
+            if (params.bitsPerPixel == 24) {
+
+                *scanptr++ = r;
+                *scanptr++ = g;
+                *scanptr++ = b;
+
+            } else if (eflag) {
+
+                *scanptr++ = (r & 0xF0) | (g >> 4);
+                *scanptr   = (b & 0xF0);
+                eflag = false;
+
+            } else {
+
+                *scanptr++ |= (r >> 4);
+                *scanptr++  = (g & 0xF0) | (b >> 4);
+                eflag = true;
+            }
+        }
+
+        // If the scanline output buffer is full now, write it to disk.
+
+        if (++scancount >= slbuff_count) {
+            scancount = 0;
+            scanptr   = scanbuff;
+            eflag     = true;
+            WriteBlock (scanbuff, scanlsize * slbuff_count);
+        }
+    }
+
+    // If there are scanlines in the scanline buffer, then write the remaining scanlines to disk.
+
+    if (scancount != 0)
+        WriteBlock (scanbuff, scanlsize * scancount);
+}
+
+//__________________________________________________________________________________________________
+
+static bool IsBackground (const uint8_t *pixels, size_t count, const uint8_t *bgPixel) {
+    // Returns true if all of the given 24-bit pixels are the background pixel color.
+
+    for (size_t i = 0;  i < count;  ++i, pixels += 3) {
+        if (pixels[0] != bgPixel[0] || pixels[1] != bgPixel[1] || pixels[2] != bgPixel[2])
+            return false;
+    }
+    return true;
+}
+
+//__________________________________________________________________________________________________
+
+static void EncodeLine (
+    const uint8_t   *line,     // Line of 24-bit RGB Pixels
+    int              width,    // Number of Pixels in Line
+    const uint8_t   *bgPixel,  // Background Pixel
+    vector<uint8_t> &out)      // Encoded Output, Appended
+{
+    // This routine encodes a single pixel line for a version 2 image file. A line of all background
+    // pixels is just the background line flag. Otherwise, the line is split into spans, where each
+    // span is a run of background pixels followed by a run of other pixels. Each span is written as
+    // two big-endian uint16 counts, followed by the non-background pixels. If the spans would take
+    // more room than the raw pixels, the line is written raw.
+
+    if (IsBackground(line, width, bgPixel)) {
+        out.push_back(lineBackground);
+        return;
+    }
+
+    auto isBackground = [&](int x) {
+        auto pixel = line + 3*x;
+        return pixel[0] == bgPixel[0] && pixel[1] == bgPixel[1] && pixel[2] == bgPixel[2];
+    };
+
+    auto putCount = [&](int count) {
+        out.push_back(static_cast<uint8_t>(0xff & (count >> 8)));
+        out.push_back(static_cast<uint8_t>(0xff & count));
+    };
+
+    const auto lineStart = out.size();
+    out.push_back(lineSpans);
+
+    const size_t rawSize = 3 * static_cast<size_t>(width);
+
+    for (auto x = 0;  x < width;  ) {
+        auto bgStart = x;
+        while (x < width && isBackground(x))
+            ++x;
+
+        auto pixelStart = x;
+        while (x < width && !isBackground(x))
+            ++x;
+
+        putCount (pixelStart - bgStart);
+        putCount (x - pixelStart);
+        out.insert(out.end(), line + 3*pixelStart, line + 3*x);
+
+        if (out.size() - lineStart - 1 >= rawSize)
+            break;
+    }
+
+    if (out.size() - lineStart - 1 >= rawSize) {
+        out.resize(lineStart);
+        out.push_back(lineRegular);
+        out.insert(out.end(), line, line + rawSize);
+    }
+}
+
+//__________________________________________________________________________________________________
+
+void WriteSlabV2 (
+    const Parameters &params,      // Program Parameters
+    const uint8_t    *slab,        // Slab Buffer of 24-bit RGB Pixels
+    int               planeCount)  // Number of Image Planes in the Slab
+{
+    // This routine writes the image planes of the slab buffer to a version 2 image file. Planes and
+    // lines that are entirely background are written as a single flag byte, and the remaining lines
+    // are run-length encoded by EncodeLine().
+
+    const auto width     = params.resolution[0];
+    const auto height    = params.resolution[1];
+    const auto lineSize  = 3 * static_cast<size_t>(width);
+    const auto planeSize = lineSize * height;
+
+    uint8_t bgPixel[3];  // Background Pixel
+    StorePixel (background, bgPixel);
+
+    vector<uint8_t> out;  // Encoded Output Buffer
+    out.reserve(scanlsize * slbuff_count + lineSize + 1);
+
+    for (auto plane = 0;  plane < planeCount;  ++plane, slab += planeSize) {
+        if (IsBackground(slab, planeSize / 3, bgPixel)) {
+            out.push_back(planeBackground);
+            continue;
+        }
+
+        out.push_back(planeRegular);
+
+        for (auto y = 0;  y < height;  ++y) {
+            EncodeLine (slab + y*lineSize, width, bgPixel, out);
+
+            // Flush the output buffer once it's at least as large as the scanline buffer.
+
+            if (out.size() >= static_cast<size_t>(scanlsize * slbuff_count)) {
+                WriteBlock (out.data(), static_cast<int>(out.size()));
+                out.clear();
+            }
+        }
+    }
+
+    if (!out.empty())
+        WriteBlock (out.data(), static_cast<int>(out.size()));
+}
+
+//__________________________________________________________________________________________________
+
+void FireRays (const Parameters &params) {
+    // This is the main routine that fires the rays through the ray grid and into the 4D scene. The
+    // ray grid is traced in slabs of TILE_ZSIZE image planes. Each slab is split into tiles that
+    // are traced in parallel on the work pool, and the completed slab is then written out in
+    // scanline order.
+
     // Handle the Z limits where we're only rendering a single slice.
     int zStart, zLimit;
     if (params.slice < 0) {
@@ -571,78 +1387,88 @@ void FireRays (const Parameters &params) {
         zLimit = params.slice + 1;
     }
 
-    for (auto zIndex = zStart;  zIndex < zLimit;  ++zIndex) {
-        Point4 zOrigin = Gorigin + (zIndex*Gz);
-        for (auto yIndex = 0;  yIndex < params.resolution[1];  ++yIndex) {
-            printf ("%6u %6u\r", params.resolution[2] - zIndex, params.resolution[1] - yIndex);
-            fflush (stdout);
+    const int xTiles    = (params.resolution[0] + TILE_XSIZE - 1) / TILE_XSIZE;
+    const int yTiles    = (params.resolution[1] + TILE_YSIZE - 1) / TILE_YSIZE;
+    const int slabDepth = std::min(TILE_ZSIZE, zLimit - zStart);
 
-            Point4 Yorigin = zOrigin + (yIndex*Gy);
+    vector<uint8_t> slab (3 * static_cast<size_t>(params.resolution[0]) * params.resolution[1] * slabDepth);
 
-            if (!eflag) {
-                ++scanptr;
-                eflag = true;
-            }
+    // Each worker thread gathers its own statistics, which are merged into those of the main
+    // thread as the workers exit.
 
-            for (auto xIndex = 0;  xIndex < params.resolution[0];  ++xIndex) {
-                Color    color;   // Pixel Color
-                Vector4  dir;     // Ray Direction Vector
-                Point4   Gpoint;  // Current Grid Point
-                double   norm;    // Vector Norm Value
+    std::mutex statsLock;
+    Stats &mainStats = stats;
 
-                // Calculate the unit ViewFrom-RayDirection vector.
+    WorkPool pool(params.threads, [&] {
+        std::lock_guard<std::mutex> guard(statsLock);
+        mainStats.merge(stats);
+    });
 
-                Gpoint = Yorigin + (xIndex*Gx);
-                dir = Gpoint - Vfrom;
-                norm = dir.norm();
-                dir /= norm;
+    traceThreads = pool.threadCount();
 
-                // Fire the ray.
+    // Open the G-buffer cache, if requested, and allocate the primary intersections of a slab.
 
-                RayTrace (Ray4(Vfrom, dir), color, 0);
+    vector<HitRecord> slabHits;
+    const size_t      planeSize = static_cast<size_t>(params.resolution[0]) * params.resolution[1];
 
-                // Scale the resulting color to 0-255.
+    if (!params.gbufferFileName.empty()) {
+        std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+        auto fileName = converter.to_bytes(params.gbufferFileName);
 
-                color *= 256.0;
-                color = color.clamp(0.0, 255.0);
+        GBufferView view {
+            Gorigin, Gx, Gy, Gz,
+            { params.resolution[0], params.resolution[1], params.resolution[2] },
+            zStart, zLimit
+        };
 
-                // Store the 24-bit RGB triple in the scanline buffer.
+        gbufferMode = OpenGBuffer (fileName.c_str(), view);
+        slabHits.resize(planeSize * slabDepth);
+    }
 
-                if (params.bitsPerPixel == 24) {
+    for (auto slabStart = zStart;  slabStart < zLimit;  slabStart += slabDepth) {
+        const int slabLimit = std::min(slabStart + slabDepth, zLimit);
 
-                    *scanptr++ = static_cast<uint8_t>(color.r);
-                    *scanptr++ = static_cast<uint8_t>(color.g);
-                    *scanptr++ = static_cast<uint8_t>(color.b);
+        printf ("%6d\r", zLimit - slabStart);
+        fflush (stdout);
 
-                } else if (eflag) {
+        {
+            PhaseTimer timer (Phase::Trace);
 
-                    *scanptr++ = (static_cast<uint8_t>(color.r) & 0xF0) | (static_cast<uint8_t>(color.g) >> 4);
-                    *scanptr   = (static_cast<uint8_t>(color.b) & 0xF0);
-                    eflag = false;
+            if (gbufferMode == GBufferMode::Read)
+                ReadGBuffer (slabHits.data(), planeSize * (slabLimit - slabStart));
 
-                } else {
+            pool.run(xTiles * yTiles, [&](int tileIndex) {
+                RayTile tile;
+                tile.xStart = (tileIndex % xTiles) * TILE_XSIZE;
+                tile.xLimit = std::min(tile.xStart + TILE_XSIZE, params.resolution[0]);
+                tile.yStart = (tileIndex / xTiles) * TILE_YSIZE;
+                tile.yLimit = std::min(tile.yStart + TILE_YSIZE, params.resolution[1]);
+                tile.zStart = slabStart;
+                tile.zLimit = slabLimit;
 
-                    *scanptr++ |= (static_cast<uint8_t>(color.r) >> 4);
-                    *scanptr++  = (static_cast<uint8_t>(color.g) & 0xF0) | (static_cast<uint8_t>(color.b) >> 4);
-                    eflag = true;
+                if (params.cellSize) {
+                    AdaptiveTile adaptive (tile, params.cellTolerance);
+                    adaptive.trace (params.cellSize);
+                    adaptive.store (params, slabStart, slab.data());
+                } else {
+                    TraceTile (params, tile, slabStart, slab.data(),
+                               slabHits.empty() ? nullptr : slabHits.data());
                 }
-            }
+            });
+        }
 
-            // If the scanline output buffer is full now, write it to disk.
+        PhaseTimer timer (Phase::Write);
 
-            if (++scancount >= slbuff_count) {
-                scancount = 0;
-                scanptr   = scanbuff;
-                eflag     = true;
-                WriteBlock (scanbuff, scanlsize * slbuff_count);
-            }
-        }
-    }
+        if (gbufferMode == GBufferMode::Write)
+            WriteGBuffer (slabHits.data(), planeSize * (slabLimit - slabStart));
 
-    // If there are scanlines in the scanline buffer, then write the remaining scanlines to disk.
+        if (params.imageVersion == 2)
+            WriteSlabV2 (params, slab.data(), slabLimit - slabStart);
+        else
+            WriteSlab (params, slab.data(), slabLimit - slabStart);
+    }
 
-    if (scancount != 0)
-        WriteBlock (scanbuff, scanlsize * scancount);
+    CloseGBuffer();
 }
 
 //__________________________________________________________________________________________________
@@ -666,9 +1492,139 @@ void ConvertUnicodeFileNames (const Parameters& params) {
 
 //__________________________________________________________________________________________________
 
+static void WriteJsonString (FILE *file, const char *str) {
+    // Writes the given UTF-8 string to the file as a quoted JSON string.
+
+    fputc ('"', file);
+
+    for (;  *str;  ++str) {
+        auto c = static_cast<unsigned char>(*str);
+
+        if (c == '"' || c == '\\')
+            fprintf (file, "\\%c", c);
+        else if (c < 0x20)
+            fprintf (file, "\\u%04x", c);
+        else
+            fputc (c, file);
+    }
+
+    fputc ('"', file);
+}
+
+//__________________________________________________________________________________________________
+
+void WriteStatsJson (const Parameters &params) {
+    // Writes the machine-readable render report requested with the --stats-json option. This must
+    // be called after the image has been traced and written, while the scene is still loaded.
+
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+    auto fileName = converter.to_bytes(params.statsFileName);
+
+    FILE *file = fopen (fileName.c_str(), "w");
+    if (!file)
+        Halt ("Open failed on statistics file (%s).", fileName.c_str());
+
+    int objectCount = 0;  // Number of Scene Objects
+    int lightCount  = 0;  // Number of Light Sources
+
+    for (auto optr = objlist;  optr;  optr = optr->next)
+        ++objectCount;
+
+    for (auto light = lightlist;  light;  light = light->next)
+        ++lightCount;
+
+    // Rays per second count every ray traced, including shadow rays, over the trace phase only.
+    // Thread utilization is the fraction of the trace threads' available time that the process
+    // spent computing.
+
+    const auto   trace     = static_cast<int>(Phase::Trace);
+    const double traceWall = 1e-9 * phaseTime[trace];
+    const double wall      = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                           - programStart).count();
+    const auto   rays      = stats.Ncast + stats.Nshadow;
+
+    const std::string versionString = version;  // Full Version Line
+    const auto        versionStart  = versionString.find(' ') + 1;
+    const auto        versionEnd    = versionString.find(' ', versionStart);
+
+    fprintf (file, "{\n");
+    fprintf (file, "  \"version\": \"%s\",\n",
+             versionString.substr(versionStart, versionEnd - versionStart).c_str());
+    fprintf (file, "  \"scene\": ");
+    WriteJsonString (file, infile);
+    fprintf (file, ",\n  \"image\": ");
+    WriteJsonString (file, outfile);
+    fprintf (file, ",\n");
+    fprintf (file, "  \"resolution\": [%d, %d, %d],\n",
+             params.resolution[0], params.resolution[1], params.resolution[2]);
+    fprintf (file, "  \"slice\": %d,\n", params.slice);
+    fprintf (file, "  \"objects\": %d,\n", objectCount);
+    fprintf (file, "  \"lights\": %d,\n", lightCount);
+    fprintf (file, "  \"threads\": %d,\n", traceThreads);
+    fprintf (file, "  \"precision\": \"%s\",\n", params.singlePrecision ? "float" : "double");
+    fprintf (file, "  \"accel\": \"%s\",\n", (params.accel == Accel::Grid) ? "grid"
+                                           : (params.accel == Accel::List) ? "list" : "bvh");
+    fprintf (file, "  \"gbuffer\": \"%s\",\n", (gbufferMode == GBufferMode::Read) ? "read"
+                                             : (gbufferMode == GBufferMode::Write) ? "written"
+                                             : "none");
+
+    fprintf (file, "  \"phases\": {\n");
+    for (auto phase = 0;  phase < static_cast<int>(Phase::Count);  ++phase) {
+        fprintf (file, "    \"%s\": { \"wallSeconds\": %.9f, \"cpuSeconds\": %.6f }%s\n",
+                 phaseKeys[phase], 1e-9 * phaseTime[phase], phaseCpu[phase],
+                 (phase + 1 < static_cast<int>(Phase::Count)) ? "," : "");
+    }
+    fprintf (file, "  },\n");
+
+    fprintf (file, "  \"wallSeconds\": %.9f,\n", wall);
+    fprintf (file, "  \"cpuSeconds\": %.6f,\n", processCpuSeconds());
+    fprintf (file, "  \"rays\": {\n");
+    fprintf (file, "    \"total\": %lld,\n", rays);
+    fprintf (file, "    \"primary\": %lld,\n", stats.Nprimary);
+    fprintf (file, "    \"reflection\": %lld,\n", stats.Nreflect);
+    fprintf (file, "    \"refraction\": %lld,\n", stats.Nrefract);
+    fprintf (file, "    \"pruned\": %lld,\n", stats.Npruned);
+    fprintf (file, "    \"interpolated\": %lld,\n", stats.Ninterp);
+    fprintf (file, "    \"shadow\": %lld\n", stats.Nshadow);
+    fprintf (file, "  },\n");
+    fprintf (file, "  \"shadowCache\": { \"tests\": %lld, \"hits\": %lld },\n",
+             stats.shadowCacheTests, stats.shadowCacheHits);
+    fprintf (file, "  \"raysPerSecond\": %.1f,\n", (traceWall > 0) ? rays / traceWall : 0.0);
+
+    static const char *typeKeys[OBJ_TYPE_COUNT] {  // Object Type Names for the Report
+        nullptr, "sphere", "tetrahedron", "triangle", "parallelepiped"
+    };
+
+    long long tests = 0;  // Total Intersection Tests
+
+    fprintf (file, "  \"tests\": {\n");
+    for (auto type = 1;  type < OBJ_TYPE_COUNT;  ++type) {
+        tests += stats.tests[type];
+        fprintf (file, "    \"%s\": { \"tests\": %lld, \"hits\": %lld }%s\n",
+                 typeKeys[type], stats.tests[type], stats.hits[type],
+                 (type + 1 < OBJ_TYPE_COUNT) ? "," : "");
+    }
+    fprintf (file, "  },\n");
+    fprintf (file, "  \"testsPerRay\": %.4f,\n", rays ? static_cast<double>(tests) / rays : 0.0);
+    fprintf (file, "  \"peakResidentBytes\": %llu,\n",
+             static_cast<unsigned long long>(peakResidentBytes()));
+    fprintf (file, "  \"bytesWritten\": %llu,\n",
+             static_cast<unsigned long long>(OutputBytesWritten()));
+    fprintf (file, "  \"threadUtilization\": %.4f\n",
+             (traceWall > 0) ? phaseCpu[trace] / (traceWall * traceThreads) : 0.0);
+    fprintf (file, "}\n");
+
+    if (fclose(file) != 0)
+        Halt ("Write error to statistics file (%s).", fileName.c_str());
+}
+
+//__________________________________________________________________________________________________
+
 int wmain (int argc, wchar_t *argv[]) {
     // The following is the entry procedure for the ray4 ray tracer.
 
+    programStart = std::chrono::steady_clock::now();
+
     Parameters params;
     if (!processParameters(params, argc, argv))
         return 1;
@@ -681,8 +1637,12 @@ int wmain (int argc, wchar_t *argv[]) {
     }
 
     ConvertUnicodeFileNames(params);
-    OpenInput(infile);
-    ParseInput();
+
+    {
+        PhaseTimer timer (Phase::Parse);
+        OpenInput(infile);
+        ParseInput();
+    }
 
     // If the global ambient factor is zero, then clear all of the ambient factor flags in the
     // objects.
@@ -696,11 +1656,30 @@ int wmain (int argc, wchar_t *argv[]) {
         }
     }
 
+    // Build the requested accelerator over the scene objects. The bounding volume hierarchy packs
+    // the primitives in the requested intersection precision.
+
+    precision = params.singlePrecision ? Precision::Float : Precision::Double;
+    accel     = params.accel;
+    minWeight = params.minWeight;
+
+    {
+        PhaseTimer timer (Phase::Build);
+
+        if (accel == Accel::BVH)
+            BuildBVH();
+        else if (accel == Accel::Grid)
+            BuildGrid();
+    }
+
     // Open the output stream and write out the image header (to be followed by the generated
     // scanline data.
 
-    OpenOutput(outfile);
-    WriteHeader(params);
+    {
+        PhaseTimer timer (Phase::Write);
+        OpenOutput(outfile, params.writeBuffers, static_cast<size_t>(params.writeBufferSize) << 20);
+        WriteHeader(params);
+    }
 
     // Determine the size of a single scanline.
 
@@ -722,11 +1701,22 @@ int wmain (int argc, wchar_t *argv[]) {
 
     scanbuff = NEW (char, scanlsize * slbuff_count);
 
-    CalcRayGrid(params);   // Calculate the grid cube to fire rays through.
+    {
+        PhaseTimer timer (Phase::Grid);
+        CalcRayGrid(params);  // Calculate the grid cube to fire rays through.
+    }
 
     StartTime = time(0);
     FireRays(params);  // Raytrace the scene.
 
+    {
+        PhaseTimer timer (Phase::Write);
+        FlushOutput();  // Wait for the image to be written.
+    }
+
+    if (!params.statsFileName.empty())
+        WriteStatsJson(params);
+
     Halt(nullptr);     // Clean up and exit.
 
     return 0;
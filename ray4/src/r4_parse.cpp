@@ -127,7 +127,8 @@ Sphere DefSphere = {
         nullptr,          // Attributes
         ObjType::Sphere,  // Object Type
         0,                // Object Flags
-        HitSphere         // Sphere-Intersection Function
+        HitSphere,        // Sphere-Intersection Function
+        OccludeSphere     // Sphere-Occlusion Function
     }
 };
 
@@ -137,7 +138,8 @@ Tetrahedron DefTetra = {
         nullptr,               // Attributes
         ObjType::Tetrahedron,  // Object Type
         0,                     // Object Flags
-        HitTetPar              // Tetrahedron-Intersection Function
+        HitTetPar,             // Tetrahedron-Intersection Function
+        OccludeTetPar          // Tetrahedron-Occlusion Function
     }
 };
 
@@ -147,7 +149,8 @@ Parallelepiped DefPllp = {
         nullptr,                  // Attributes
         ObjType::Parallelepiped,  // Object Type
         0,                        // Object Flags
-        HitTetPar                 // Parallelepiped-Intersection Function
+        HitTetPar,                // Parallelepiped-Intersection Function
+        OccludeTetPar             // Parallelepiped-Occlusion Function
     }
 };
 
@@ -157,7 +160,8 @@ Triangle DefTriangle = {
         nullptr,            // Attributes
         ObjType::Triangle,  // Object Type
         0,                  // Object Flags
-        HitTriangle         // Triangle-Intersection Function
+        HitTriangle,        // Triangle-Intersection Function
+        OccludeTriangle     // Triangle-Occlusion Function
     }
 };
 
@@ -189,14 +193,6 @@ void Error (const char *format, ...) {
 
     va_end(args);
 
-    // Kill the attributes name list.
-
-    AttrName *attrname;  // Attribute Name Node Pointer
-    while (attrname = attrnamelist, attrname) {
-        attrnamelist = attrname->next;
-        DELETE (attrname);
-    }
-
     // Halt the program.
 
     Halt ("Aborting.");
@@ -505,13 +501,9 @@ void ParseInput () {
         }
     }
 
-    // Kill the attributes alias list.
+    // Drop the attributes alias list. Its nodes live in the scene arena, and are freed with it.
 
-    AttrName *attrname;  // Attribute Name Node Pointer
-    while (attrname=attrnamelist, attrname) {
-        attrnamelist = attrname->next;
-        DELETE (attrname);
-    }
+    attrnamelist = nullptr;
 }
 
 //__________________________________________________________________________________________________
@@ -686,6 +678,19 @@ void DoLight () {
 
 //__________________________________________________________________________________________________
 
+void LinkObject (ObjInfo *object) {
+    // This routine assigns the next object ID to a newly defined object and adds the object to the
+    // head of the object list.
+
+    static unsigned nextID = 0;  // Next Object ID
+
+    object->id   = nextID++;
+    object->next = objlist;
+    objlist = object;
+}
+
+//__________________________________________________________________________________________________
+
 void DoSphere () {
     // This routine reads in a description of a hyperspherical object from the input stream and adds
     // it to the object list. The field defaults are defined by the DefSphere structure for the
@@ -722,8 +727,11 @@ void DoSphere () {
 
     snew->rsqrd = snew->radius * snew->radius;
 
-    snew->info.next = objlist;
-    objlist = reinterpret_cast<ObjInfo *>(prev = snew);
+    const Vector4 radius { snew->radius, snew->radius, snew->radius, snew->radius };
+    snew->info.bounds = Bounds4(snew->center - radius, snew->center + radius);
+
+    LinkObject (&snew->info);
+    prev = snew;
 }
 
 //__________________________________________________________________________________________________
@@ -745,46 +753,67 @@ void Process_TetPar (TetPar *tp) {
 
         if (!tp->normal.normalize())
             Error ("Degenerate parallelepiped/tetrahedron; not 3D.");
+    }
 
-        // Find the dominant axis of the normal vector and load up the ax1, ax2 and ax3 fields
-        // accordingly.
+    // Calculate the hyperplane constant.
+
+    tp->planeConst = - dot(tp->normal, tp->vert[0].toVector());
+
+    // Calculate the barycentric projection, which maps a point on the hyperplane directly to its
+    // barycentric coordinates (Bc1, Bc2, Bc3) relative to vertices 1, 2 and 3. To keep from
+    // `squishing' the object, it's projected onto the three axes that are not dominant in the
+    // normal vector. On those axes, the barycentric coordinates of point P solve
+    //
+    //     P - V0 = (Bc1 * vec1) + (Bc2 * vec2) + (Bc3 * vec3)
+    //
+    // The rows of the inverse of the matrix [vec1 vec2 vec3] are the cross products of pairs of its
+    // columns, divided by its determinant. Spread back out over all four axes (with a zero for the
+    // dominant axis) and offset by vertex 0, they give each barycentric coordinate as a dot
+    // product plus a constant.
+
+    {
+        int ax[3];  // Non-Dominant Normal Vector Axes
 
         int dominant1 = (fabs(tp->normal.x) > fabs(tp->normal.y)) ? 0 : 1;
         int dominant2 = (fabs(tp->normal.z) > fabs(tp->normal.w)) ? 2 : 3;
         if (fabs(tp->normal[dominant1]) > fabs(tp->normal[dominant2])) {
-            tp->ax1 = (dominant1 == 0) ? 1 : 0;
-            tp->ax2 = 2;
-            tp->ax3 = 3;
+            ax[0] = (dominant1 == 0) ? 1 : 0;
+            ax[1] = 2;
+            ax[2] = 3;
         } else {
-            tp->ax1 = 0;
-            tp->ax2 = 1;
-            tp->ax3 = (dominant2 == 2) ? 3 : 2;
+            ax[0] = 0;
+            ax[1] = 1;
+            ax[2] = (dominant2 == 2) ? 3 : 2;
         }
-    }
 
-    // Calculate the hyperplane constant.
-
-    tp->planeConst = - dot(tp->normal, tp->vert[0].toVector());
-
-    // Calculate the divisor for Cramer's Rule used to determine the barycentric coordinates of
-    // intersection points.
+        double M[3][3];  // Edge Vectors (Columns) on the Non-Dominant Axes (Rows)
+        for (auto i = 0;  i < 3;  ++i) {
+            M[i][0] = tp->vec1[ax[i]];
+            M[i][1] = tp->vec2[ax[i]];
+            M[i][2] = tp->vec3[ax[i]];
+        }
 
-    {
-        double M11 = tp->vec1[tp->ax1];
-        double M12 = tp->vec1[tp->ax2];
-        double M13 = tp->vec1[tp->ax3];
+        // Each row of the inverse is the cross product of the other two columns.
 
-        double M21 = tp->vec2[tp->ax1];
-        double M22 = tp->vec2[tp->ax2];
-        double M23 = tp->vec2[tp->ax3];
+        double inverse[3][3];  // Inverse Matrix, Before Division by the Determinant
+        for (auto k = 0;  k < 3;  ++k) {
+            const auto j1 = (k + 1) % 3;
+            const auto j2 = (k + 2) % 3;
+            inverse[k][0] = (M[1][j1] * M[2][j2]) - (M[2][j1] * M[1][j2]);
+            inverse[k][1] = (M[2][j1] * M[0][j2]) - (M[0][j1] * M[2][j2]);
+            inverse[k][2] = (M[0][j1] * M[1][j2]) - (M[1][j1] * M[0][j2]);
+        }
 
-        double M31 = tp->vec3[tp->ax1];
-        double M32 = tp->vec3[tp->ax2];
-        double M33 = tp->vec3[tp->ax3];
+        const double determinant = (M[0][0] * inverse[0][0]) + (M[1][0] * inverse[0][1])
+                                 + (M[2][0] * inverse[0][2]);
+        const double invDet = 1.0 / determinant;
 
-        tp->CramerDiv = M11 * (M22*M33 - M23*M32)
-                      - M21 * (M12*M33 - M13*M32)
-                      + M31 * (M12*M23 - M13*M22);
+        for (auto k = 0;  k < 3;  ++k) {
+            tp->bary[k] = Vector4 { 0.0, 0.0, 0.0, 0.0 };
+            for (auto i = 0;  i < 3;  ++i)
+                tp->bary[k][ax[i]] = inverse[k][i] * invDet;
+            tp->baryConst[k] = - dot(tp->bary[k], tp->vert[0].toVector());
+        }
     }
 }
 
@@ -823,8 +852,20 @@ void DoParallelepiped () {
     if (!pnew->info.attr)
         Error ("Missing attributes for parallelepiped description.");
 
-    pnew->info.next = objlist;
-    objlist = reinterpret_cast<ObjInfo *>(prev = pnew);
+    // The bounding box must enclose all eight corners: vertex 0 plus each combination of the three
+    // edge vectors.
+
+    pnew->info.bounds = Bounds4(pnew->tp.vert[0]);
+    for (auto corner = 1;  corner < 8;  ++corner) {
+        Point4 p = pnew->tp.vert[0];
+        if (corner & 1) p += pnew->tp.vec1;
+        if (corner & 2) p += pnew->tp.vec2;
+        if (corner & 4) p += pnew->tp.vec3;
+        pnew->info.bounds.include(p);
+    }
+
+    LinkObject (&pnew->info);
+    prev = pnew;
 }
 
 //__________________________________________________________________________________________________
@@ -862,8 +903,39 @@ void DoTetrahedron () {
     if (!tnew->info.attr)
         Error ("Missing attributes for tetrahedron description.");
 
-    tnew->info.next = objlist;
-    objlist = reinterpret_cast<ObjInfo *>(prev = tnew);
+    tnew->info.bounds = Bounds4(tnew->tp.vert[0]);
+    for (auto i = 1;  i < 4;  ++i)
+        tnew->info.bounds.include(tnew->tp.vert[i]);
+
+    LinkObject (&tnew->info);
+    prev = tnew;
+}
+
+//__________________________________________________________________________________________________
+
+void Process_Triangle (Triangle *tri) {
+    // This routine initializes the physical data fields of the triangle structure.
+
+    // Compute the two vectors from vertex 0 to vertices 1 and 2.
+
+    tri->vec1 = tri->vert[1] - tri->vert[0];
+    tri->vec2 = tri->vert[2] - tri->vert[0];
+
+    // Every 4D cross product in the triangle intersection test takes the two edge vectors as its
+    // last two operands, and so uses the same six 2x2 minors of the edge vectors. These minors
+    // (which are also the Cramer's rule divisors for each pair of projection axes) depend only on
+    // the triangle, so compute them once here. They're computed exactly as cross() would, so that
+    // the intersection results are unchanged.
+
+    const Vector4 &v = tri->vec1;
+    const Vector4 &w = tri->vec2;
+
+    tri->minor[0] = (v.x * w.y) - (v.y * w.x);
+    tri->minor[1] = (v.x * w.z) - (v.z * w.x);
+    tri->minor[2] = (v.x * w.w) - (v.w * w.x);
+    tri->minor[3] = (v.y * w.z) - (v.z * w.y);
+    tri->minor[4] = (v.y * w.w) - (v.w * w.y);
+    tri->minor[5] = (v.z * w.w) - (v.w * w.z);
 }
 
 //__________________________________________________________________________________________________
@@ -894,16 +966,19 @@ void DoTriangle () {
         }
     }
 
-    // Compute the two vectors from vertex 0 to vertices 1 and 2.
-
-    tnew->vec1 = tnew->vert[1] - tnew->vert[0];
-    tnew->vec2 = tnew->vert[2] - tnew->vert[0];
+    Process_Triangle (tnew);
 
     if (!tnew->info.attr)
         Error ("Missing attributes for triangle description.");
 
-    tnew->info.next = objlist;
-    objlist = reinterpret_cast<ObjInfo *>(prev = tnew);
+    // A generic ray never passes exactly through a 2D triangle in 4-space, so the triangle is hit
+    // where the ray passes nearest to its plane and over the triangle (see HitTriangle()). That
+    // point may lie arbitrarily far from the triangle itself, so triangles are unbounded.
+
+    tnew->info.bounds = Bounds4::infinite();
+
+    LinkObject (&tnew->info);
+    prev = tnew;
 }
 
 //__________________________________________________________________________________________________
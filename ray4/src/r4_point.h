@@ -21,47 +21,155 @@
 #ifndef R4_POINT_H
 #define R4_POINT_H
 
+//==================================================================================================
+// r4_point.h
+//
+// Point4 is defined entirely inline, like Vector4, so that point arithmetic costs no more than the
+// equivalent scalar code. Like vectors, points are templated on their coordinate type (Point4 and
+// Point4f), and double-precision points share the Vector4 SIMD backend.
+//==================================================================================================
+
+#include <algorithm>
 #include <cstddef>
+#include <type_traits>
 #include "r4_vector.h"
 
 
 
 //__________________________________________________________________________________________________
 
-class Point4 {
+template<typename Real>
+class Point4T {
     // Represents a four-dimensional point.
 
   public:
-    double x, y, z, w;
-
-    Point4() = default;
-    Point4(const Point4&) = default;
-    ~Point4() = default;
-    Point4& operator= (const Point4 &other) = default;
-
-    Point4(double x, double y, double z, double w) : x(x), y(y), z(z), w(w) {}
-
-    bool operator== (const Point4& other) const;
-    bool operator!= (const Point4& other) const;
-
-    const double& operator[] (std::size_t index) const;
-          double& operator[] (std::size_t index);
-
-    Point4& operator+= (const Vector4&);
-    Point4& operator-= (const Vector4&);
+    Real x, y, z, w;
+
+    Point4T() = default;
+    constexpr Point4T(const Point4T&) = default;
+    ~Point4T() = default;
+    constexpr Point4T& operator= (const Point4T &other) = default;
+
+    constexpr Point4T(Real x, Real y, Real z, Real w) : x(x), y(y), z(z), w(w) {}
+
+    // Converts a point of another precision.
+    template<typename Other>
+    constexpr explicit Point4T(const Point4T<Other>& p)
+      : x(static_cast<Real>(p.x)), y(static_cast<Real>(p.y)),
+        z(static_cast<Real>(p.z)), w(static_cast<Real>(p.w)) {}
+
+    constexpr bool operator== (const Point4T& other) const {
+        return x == other.x && y == other.y && z == other.z && w == other.w;
+    }
+
+    constexpr bool operator!= (const Point4T& other) const {
+        return !(*this == other);
+    }
+
+    // Returns the coordinate with the given index, where indices above 3 select w. See Vector4.
+    constexpr const Real& operator[] (std::size_t index) const {
+        constexpr Real Point4T::* coordinates[]
+            { &Point4T::x, &Point4T::y, &Point4T::z, &Point4T::w };
+        return this->*coordinates[std::min<std::size_t>(index, 3)];
+    }
+
+    constexpr Real& operator[] (std::size_t index) {
+        constexpr Real Point4T::* coordinates[]
+            { &Point4T::x, &Point4T::y, &Point4T::z, &Point4T::w };
+        return this->*coordinates[std::min<std::size_t>(index, 3)];
+    }
+
+    constexpr Point4T& operator+= (const Vector4T<Real>& v) {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (Vector4T<Real>::simdBackend) {
+            if (!std::is_constant_evaluated()) {
+                simd::store(&x, _mm256_add_pd(simd::load(&x), simd::load(&v.x)));
+                return *this;
+            }
+        }
+      #endif
+        x += v.x;
+        y += v.y;
+        z += v.z;
+        w += v.w;
+        return *this;
+    }
+
+    constexpr Point4T& operator-= (const Vector4T<Real>& v) {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (Vector4T<Real>::simdBackend) {
+            if (!std::is_constant_evaluated()) {
+                simd::store(&x, _mm256_sub_pd(simd::load(&x), simd::load(&v.x)));
+                return *this;
+            }
+        }
+      #endif
+        x -= v.x;
+        y -= v.y;
+        z -= v.z;
+        w -= v.w;
+        return *this;
+    }
 
     // Returns the vector from the origin to the point. In other words, the vector with all
     // coordinates equal to the point coordinates.
-    Vector4 toVector() const;
-
-    Vector4 operator- (const Point4&) const;
-    Point4 operator+ (const Vector4&) const;
-    Point4 operator- (const Vector4&) const;
+    constexpr Vector4T<Real> toVector() const {
+        return {x, y, z, w};
+    }
+
+    constexpr Vector4T<Real> operator- (const Point4T& other) const {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (Vector4T<Real>::simdBackend) {
+            if (!std::is_constant_evaluated())
+                return Vector4T<Real>::fromSimd(
+                    _mm256_sub_pd(simd::load(&x), simd::load(&other.x)));
+        }
+      #endif
+        return { x - other.x, y - other.y, z - other.z, w - other.w };
+    }
+
+    constexpr Point4T operator+ (const Vector4T<Real>& v) const {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (Vector4T<Real>::simdBackend) {
+            if (!std::is_constant_evaluated())
+                return fromSimd(_mm256_add_pd(simd::load(&x), simd::load(&v.x)));
+        }
+      #endif
+        return { x + v.x, y + v.y, z + v.z, w + v.w };
+    }
+
+    constexpr Point4T operator- (const Vector4T<Real>& v) const {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (Vector4T<Real>::simdBackend) {
+            if (!std::is_constant_evaluated())
+                return fromSimd(_mm256_sub_pd(simd::load(&x), simd::load(&v.x)));
+        }
+      #endif
+        return { x - v.x, y - v.y, z - v.z, w - v.w };
+    }
+
+  #if defined(RAY4_SIMD_AVX2)
+    // Returns the point held in the given SIMD register.
+    static Point4T fromSimd(simd::Double4 value) {
+        Point4T result;
+        simd::store(&result.x, value);
+        return result;
+    }
+  #endif
 };
 
+using Point4  = Point4T<double>;  // Double-Precision Point
+using Point4f = Point4T<float>;   // Single-Precision Point
+
 
-inline Point4 operator+ (const Vector4& v, const Point4& p) {
+template<typename Real>
+constexpr Point4T<Real> operator+ (const Vector4T<Real>& v, const Point4T<Real>& p) {
     return p + v;
 }
 
+#if defined(RAY4_SIMD_AVX2)
+static_assert(std::is_standard_layout_v<Point4> && sizeof(Point4) == 4 * sizeof(double),
+              "The SIMD backend requires Point4 coordinates to be four consecutive doubles.");
+#endif
+
 #endif
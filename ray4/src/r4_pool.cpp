@@ -0,0 +1,153 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// r4_pool.cpp
+//
+// This file contains the implementation of the WorkPool work-stealing thread pool. See r4_pool.h
+// for more information.
+//==================================================================================================
+
+#include "r4_pool.h"
+
+#include <algorithm>
+
+
+
+//__________________________________________________________________________________________________
+
+WorkPool::WorkPool (int threadCount, std::function<void()> threadExit)
+  : ranges(threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency())),
+    threadExit(threadExit)
+{
+    for (auto worker = 1;  worker < static_cast<int>(ranges.size());  ++worker)
+        threads.emplace_back(&WorkPool::workerMain, this, worker);
+}
+
+//__________________________________________________________________________________________________
+
+WorkPool::~WorkPool () {
+    {
+        std::lock_guard<std::mutex> guard(runLock);
+        stopping = true;
+    }
+    runStart.notify_all();
+
+    for (auto &thread : threads)
+        thread.join();
+}
+
+//__________________________________________________________________________________________________
+
+void WorkPool::run (int jobCount, const std::function<void(int)>& jobFunc) {
+    // Split the jobs into contiguous ranges, one per worker, so that each worker starts out on a
+    // coherent block of the work.
+
+    const auto workerCount = static_cast<int>(ranges.size());
+
+    for (auto worker = 0;  worker < workerCount;  ++worker) {
+        std::lock_guard<std::mutex> guard(ranges[worker].lock);
+        ranges[worker].next  = static_cast<int>((static_cast<long long>(jobCount) * worker) / workerCount);
+        ranges[worker].limit = static_cast<int>((static_cast<long long>(jobCount) * (worker+1)) / workerCount);
+    }
+
+    // Wake the spawned workers, do our own share of the work, and then wait for the others.
+
+    {
+        std::lock_guard<std::mutex> guard(runLock);
+        job  = &jobFunc;
+        busy = workerCount - 1;
+        ++generation;
+    }
+    runStart.notify_all();
+
+    doJobs(0);
+
+    std::unique_lock<std::mutex> guard(runLock);
+    runDone.wait(guard, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+//__________________________________________________________________________________________________
+
+bool WorkPool::takeJob (int worker, int &jobIndex) {
+    // Takes the next job for the given worker. Jobs come first from the front of the worker's own
+    // range, then from the back of the other workers' ranges. Returns false when no work remains.
+
+    {
+        auto &own = ranges[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.next < own.limit) {
+            jobIndex = own.next++;
+            return true;
+        }
+    }
+
+    const auto workerCount = static_cast<int>(ranges.size());
+
+    for (auto offset = 1;  offset < workerCount;  ++offset) {
+        auto &victim = ranges[(worker + offset) % workerCount];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.next < victim.limit) {
+            jobIndex = --victim.limit;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//__________________________________________________________________________________________________
+
+void WorkPool::doJobs (int worker) {
+    int jobIndex;
+    while (takeJob(worker, jobIndex))
+        (*job)(jobIndex);
+}
+
+//__________________________________________________________________________________________________
+
+void WorkPool::workerMain (int worker) {
+    // The main loop of each spawned worker thread.
+
+    unsigned long lastGeneration = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(runLock);
+            runStart.wait(guard, [&] { return stopping || generation != lastGeneration; });
+            if (stopping)
+                break;
+            lastGeneration = generation;
+        }
+
+        doJobs(worker);
+
+        {
+            std::lock_guard<std::mutex> guard(runLock);
+            if (--busy == 0)
+                runDone.notify_one();
+        }
+    }
+
+    if (threadExit)
+        threadExit();
+}
@@ -0,0 +1,88 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+#ifndef R4_POOL_H
+#define R4_POOL_H
+
+//==================================================================================================
+// r4_pool.h
+//
+// A small work-stealing thread pool used to spread independent jobs (such as the ray-grid tiles of
+// the image cube) over all available processors.
+//==================================================================================================
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+//__________________________________________________________________________________________________
+
+class WorkPool {
+    // A fixed set of worker threads that run indexed jobs. The calling thread takes part in the
+    // work as worker zero. Each run() splits the job indices into one contiguous range per worker;
+    // a worker takes jobs from the front of its own range, and once that is exhausted, steals jobs
+    // from the back of the other workers' ranges.
+
+  public:
+    // Creates a pool with the given total number of threads, including the calling thread. A
+    // thread count of zero selects one thread per hardware processor. If given, the threadExit
+    // function is called from each spawned worker thread just before that thread terminates.
+    WorkPool(int threadCount, std::function<void()> threadExit = nullptr);
+    ~WorkPool();
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator= (const WorkPool&) = delete;
+
+    int threadCount() const { return static_cast<int>(ranges.size()); }
+
+    // Runs job(i) for every i in [0, jobCount), and returns once all jobs have completed.
+    void run(int jobCount, const std::function<void(int)>& job);
+
+  private:
+    struct alignas(64) JobRange {  // Cache-line aligned to keep workers from sharing lines.
+        std::mutex lock;
+        int        next  { 0 };  // Next job index to take from the front
+        int        limit { 0 };  // One past the last job index of this range
+    };
+
+    bool takeJob (int worker, int &jobIndex);
+    void doJobs  (int worker);
+    void workerMain (int worker);
+
+    std::vector<JobRange>    ranges;      // Per-Worker Job Ranges
+    std::vector<std::thread> threads;     // Spawned Worker Threads (Workers 1..N-1)
+    std::function<void()>    threadExit;  // Worker Thread Exit Callback
+
+    // The following fields are guarded by runLock.
+
+    std::mutex                       runLock;
+    std::condition_variable          runStart;              // Signaled on new work or shutdown
+    std::condition_variable          runDone;               // Signaled when all workers finish
+    const std::function<void(int)>  *job        { nullptr };  // Current Job Function
+    unsigned long                    generation { 0 };        // Incremented on each run()
+    int                              busy       { 0 };        // Spawned workers still working
+    bool                             stopping   { false };    // True on pool shutdown
+};
+
+#endif
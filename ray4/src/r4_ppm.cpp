@@ -0,0 +1,117 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// r4_ppm.cpp
+//
+// This file contains the PPM image file encoders. See r4_ppm.h for more information.
+//==================================================================================================
+
+#include "r4_ppm.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+
+
+
+//__________________________________________________________________________________________________
+
+struct DecimalText {
+    char    digits[4];  // Decimal Digits, Unused Trailing Bytes Zero
+    uint8_t length;     // Number of Digits
+};
+
+static constexpr std::array<DecimalText, 256> makeDecimalTable () {
+    // Builds the table of decimal text for all byte values 0-255.
+
+    std::array<DecimalText, 256> table {};
+
+    for (auto value = 0;  value < 256;  ++value) {
+        auto &entry = table[value];
+        auto  n     = 0;
+
+        if (value >= 100) entry.digits[n++] = static_cast<char>('0' + value / 100);
+        if (value >=  10) entry.digits[n++] = static_cast<char>('0' + (value / 10) % 10);
+        entry.digits[n++] = static_cast<char>('0' + value % 10);
+        entry.length = static_cast<uint8_t>(n);
+    }
+
+    return table;
+}
+
+static constexpr auto decimalTable = makeDecimalTable();
+
+//__________________________________________________________________________________________________
+
+void encodePPM (const uint8_t *pixels, int width, int height, bool ascii, std::string &fileData) {
+    // The ASCII format writes one pixel per line, as "<r> <g> <b>\n".
+
+    const auto pixelCount = static_cast<size_t>(width) * height;
+
+    fileData = (ascii ? "P3\n" : "P6\n")
+             + std::to_string(width) + ' ' + std::to_string(height) + "\n255\n";
+
+    const auto headerSize = fileData.size();
+
+    if (!ascii) {
+        fileData.resize(headerSize + 3 * pixelCount);
+        memcpy (fileData.data() + headerSize, pixels, 3 * pixelCount);
+        return;
+    }
+
+    // Each pixel takes at most 12 characters ("255 255 255\n"). Each channel copies all four bytes
+    // of its table entry, but the cursor only advances by the digit count, and the final channel
+    // of a pixel still ends within that pixel's 12 characters.
+
+    fileData.resize(headerSize + 12 * pixelCount);
+
+    auto out = fileData.data() + headerSize;
+
+    for (size_t i = 0;  i < pixelCount;  ++i) {
+        for (auto channel = 0;  channel < 3;  ++channel) {
+            const auto &text = decimalTable[*pixels++];
+            memcpy (out, text.digits, 4);
+            out += text.length;
+            *out++ = (channel < 2) ? ' ' : '\n';
+        }
+    }
+
+    fileData.resize(out - fileData.data());
+}
+
+//__________________________________________________________________________________________________
+
+bool writePPM (
+    const std::filesystem::path &fileName, const uint8_t *pixels, int width, int height, bool ascii)
+{
+    std::string fileData;
+    encodePPM (pixels, width, height, ascii, fileData);
+
+    std::ofstream outputImage(fileName, std::ios::binary | std::ios::out);
+    if (!outputImage.good())
+        return false;
+
+    outputImage.write(fileData.data(), static_cast<std::streamsize>(fileData.size()));
+    outputImage.close();
+
+    return !outputImage.fail();
+}
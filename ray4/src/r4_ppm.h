@@ -0,0 +1,45 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+#ifndef R4_PPM_H
+#define R4_PPM_H
+
+//==================================================================================================
+// r4_ppm.h
+//
+// Encoding of image planes as PPM image files (see https://en.wikipedia.org/wiki/Netpbm). An entire
+// plane is formatted in memory and then written to the file with a single write.
+//==================================================================================================
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+
+// Encodes a plane of 24-bit RGB pixels as a complete binary (P6) or ASCII (P3) PPM image file,
+// replacing the contents of fileData.
+void encodePPM (const uint8_t *pixels, int width, int height, bool ascii, std::string &fileData);
+
+// Encodes a plane of 24-bit RGB pixels as a PPM image and writes it to the given file. Returns
+// false if the file could not be written.
+bool writePPM (
+    const std::filesystem::path &fileName, const uint8_t *pixels, int width, int height, bool ascii);
+
+#endif
@@ -18,25 +18,24 @@
 //  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 //  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //**************************************************************************************************
+#ifndef R4_PROCESS_H
+#define R4_PROCESS_H
 
-#include "ray4.h"
-
-
-
-//__________________________________________________________________________________________________
+//==================================================================================================
+// r4_process.h
+//
+// Queries of the resources used by the running process, for the render statistics report.
+//==================================================================================================
 
-bool Ray4::operator== (const Ray4& other) const {
-    return origin == other.origin && direction == other.direction;
-}
+#include <cstdint>
 
-//__________________________________________________________________________________________________
 
-bool Ray4::operator!= (const Ray4& other) const {
-    return !(*this == other);
-}
+// Returns the total processor time, in seconds, used by all threads of the process so far, in both
+// user and kernel mode.
+double processCpuSeconds ();
 
-//__________________________________________________________________________________________________
+// Returns the peak resident set size (Windows: peak working set) of the process in bytes, or zero
+// if it isn't available.
+uint64_t peakResidentBytes ();
 
-Point4 Ray4::operator() (double t) const {
-    return origin + t*direction;
-}
+#endif
@@ -28,24 +28,43 @@
 
 //__________________________________________________________________________________________________
 
-class Ray4 {
-    // A ray (with origin and direction) in four-dimensional space.
+template<typename Real>
+class Ray4T {
+    // A ray (with origin and direction) in four-dimensional space, with coordinates of the given
+    // floating-point type. Ray4 is the double-precision ray, and Ray4f the single-precision ray.
 
   public:
-    Point4  origin;
-    Vector4 direction;
+    Point4T<Real>  origin;
+    Vector4T<Real> direction;
 
-    Ray4() = default;
-    Ray4(const Ray4&) = default;
-    ~Ray4() = default;
-    Ray4& operator= (const Ray4 &other) = default;
+    Ray4T() = default;
+    constexpr Ray4T(const Ray4T&) = default;
+    ~Ray4T() = default;
+    constexpr Ray4T& operator= (const Ray4T &other) = default;
 
-    Ray4(Point4 origin, Vector4 direction) : origin(origin), direction(direction) {}
+    constexpr Ray4T(Point4T<Real> origin, Vector4T<Real> direction)
+      : origin(origin), direction(direction) {}
 
-    bool operator== (const Ray4& other) const;
-    bool operator!= (const Ray4& other) const;
+    // Converts a ray of another precision.
+    template<typename Other>
+    constexpr explicit Ray4T(const Ray4T<Other>& ray)
+      : origin(ray.origin), direction(ray.direction) {}
 
-    Point4 operator() (double t) const;
+    constexpr bool operator== (const Ray4T& other) const {
+        return origin == other.origin && direction == other.direction;
+    }
+
+    constexpr bool operator!= (const Ray4T& other) const {
+        return !(*this == other);
+    }
+
+    // Returns the point at parameter t along the ray.
+    constexpr Point4T<Real> operator() (Real t) const {
+        return origin + t*direction;
+    }
 };
 
+using Ray4  = Ray4T<double>;  // Double-Precision Ray
+using Ray4f = Ray4T<float>;   // Single-Precision Ray
+
 #endif
@@ -1,9 +1,18 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <format>
+#include <limits>
 #include <string>
+#include <vector>
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "r4_arena.h"
+#include "r4_bounds.h"
 #include "r4_color.h"
 #include "r4_vector.h"
 #include "r4_point.h"
+#include "r4_ppm.h"
 #include "r4_ray.h"
 
 
@@ -271,3 +280,253 @@ TEST_CASE("Ray tests", "[ray]") {
         CHECK(r(-1.0) == Point4(-1,-2,-3,-4));
     }
 }
+
+//__________________________________________________________________________________________________
+
+TEST_CASE("Single-precision math", "[vector4][point4][ray]") {
+    SECTION("Precision conversion") {
+        Ray4 r { Point4(1, 2, 3, 0.1), Vector4(0.5, 0.25, -1, 2) };
+        Ray4f rf { r };
+
+        CHECK(rf.origin == Point4f(1, 2, 3, 0.1f));
+        CHECK(rf.direction == Vector4f(0.5f, 0.25f, -1, 2));
+        CHECK(Ray4(rf).origin.w == static_cast<double>(0.1f));
+    }
+
+    SECTION("Single-precision arithmetic") {
+        Ray4f rf { Point4f(0,0,0,0), Vector4f(1,2,3,4) };
+
+        CHECK(rf(2.0f) == Point4f(2,4,6,8));
+        CHECK(dot(Vector4f(1,2,3,4), Vector4f(1,1,1,1)) == 10.0f);
+        CHECK(cross(Vector4f(1,0,0,0), Vector4f(0,1,0,0), Vector4f(0,0,1,0)) == Vector4f(0,0,0,-1));
+        CHECK(Point4f(1,1,1,1) - Point4f(0,1,2,3) == Vector4f(1,0,-1,-2));
+    }
+}
+
+//__________________________________________________________________________________________________
+
+TEST_CASE("Constexpr math", "[vector4][point4][color]") {
+    // The math types are fully usable in constant expressions.
+
+    STATIC_REQUIRE(dot(Vector4(1,2,3,4), Vector4(1,1,1,1)) == 10);
+    STATIC_REQUIRE(cross(Vector4(1,0,0,0), Vector4(0,1,0,0), Vector4(0,0,1,0)) == Vector4(0,0,0,-1));
+    STATIC_REQUIRE(Vector4(1,2,3,4)[2] == 3);
+    STATIC_REQUIRE(Point4(1,2,3,4)[3] == 4);
+    STATIC_REQUIRE(Point4(1,1,1,1) - Point4(0,1,2,3) == Vector4(1,0,-1,-2));
+    STATIC_REQUIRE(Ray4(Point4(0,0,0,0), Vector4(1,2,3,4))(2) == Point4(2,4,6,8));
+    STATIC_REQUIRE(Color(2,0.5,-1).clamp(0,1) == Color(1,0.5,0));
+}
+
+//__________________________________________________________________________________________________
+
+TEST_CASE("Bounds tests", "[bounds4]") {
+    auto b1 = Bounds4(Point4(0,0,0,0), Point4(1,2,3,4));
+
+    SECTION("Bounds equality") {
+        REQUIRE(b1 == Bounds4(Point4(0,0,0,0), Point4(1,2,3,4)));
+        REQUIRE(b1 != Bounds4(Point4(0,0,0,0), Point4(1,2,3,5)));
+        REQUIRE_FALSE(b1 != b1);
+    }
+
+    SECTION("Bounds growth") {
+        auto b = Bounds4::empty();
+        REQUIRE(b.isEmpty());
+        CHECK(b.surfaceMeasure() == 0.0);
+
+        b.include(Point4(1,2,3,4));
+        REQUIRE_FALSE(b.isEmpty());
+        CHECK(b == Bounds4(Point4(1,2,3,4)));
+
+        b.include(Point4(0,0,0,0));
+        CHECK(b == b1);
+
+        b.include(Bounds4(Point4(-1,-1,-1,-1), Point4(0,0,0,0)));
+        CHECK(b == Bounds4(Point4(-1,-1,-1,-1), Point4(1,2,3,4)));
+
+        b1.pad(1);
+        CHECK(b1 == Bounds4(Point4(-1,-1,-1,-1), Point4(2,3,4,5)));
+    }
+
+    SECTION("Bounds properties") {
+        CHECK(b1.center() == Point4(0.5, 1, 1.5, 2));
+        CHECK(b1.extent() == Vector4(1,2,3,4));
+        CHECK(b1.majorAxis() == 3);
+        CHECK(b1.surfaceMeasure() == 2 * (6 + 8 + 12 + 24));
+        CHECK(b1.isFinite());
+        CHECK_FALSE(Bounds4::infinite().isFinite());
+    }
+
+    SECTION("Bounds ray intersection") {
+        auto unit = Bounds4(Point4(-1,-1,-1,-1), Point4(1,1,1,1));
+        auto inf  = std::numeric_limits<double>::infinity();
+
+        auto hits = [&](Point4 origin, Vector4 dir, double tmax) {
+            auto invDir = Vector4(1/dir.x, 1/dir.y, 1/dir.z, 1/dir.w);
+            return unit.hit(Ray4(origin, dir), invDir, 0.0, tmax);
+        };
+
+        CHECK(hits(Point4(0,0,0,5), Vector4(0,0,0,-1), inf));    // Axis-aligned, straight on
+        CHECK_FALSE(hits(Point4(0,0,0,5), Vector4(0,0,0,-1), 3));  // Stops short of the box
+        CHECK_FALSE(hits(Point4(0,0,0,5), Vector4(0,0,0,1), inf));  // Box is behind the ray
+        CHECK_FALSE(hits(Point4(2,0,0,5), Vector4(0,0,0,-1), inf)); // Passes beside the box
+        CHECK(hits(Point4(0,0,0,0), Vector4(1,0,0,0), inf));       // Starts inside the box
+        CHECK(hits(Point4(1,0,0,5), Vector4(0,0,0,-1), inf));      // Grazes the box boundary
+        CHECK(hits(Point4(3,3,3,3), Vector4(-1,-1,-1,-1), inf));   // Diagonal
+    }
+
+    SECTION("Bounds ray clipping") {
+        auto unit = Bounds4(Point4(-1,-1,-1,-1), Point4(1,1,1,1));
+        auto ray  = Ray4(Point4(0,0,0,5), Vector4(0,0,0,-1));
+        auto inv  = Vector4(1/ray.direction.x, 1/ray.direction.y, 1/ray.direction.z, -1);
+
+        double tmin = 0, tmax = 100;
+        CHECK(unit.clip(ray, inv, tmin, tmax));
+        CHECK(tmin == 4);
+        CHECK(tmax == 6);
+
+        tmin = 5;
+        tmax = 100;
+        CHECK(unit.clip(ray, inv, tmin, tmax));  // Starts inside the box
+        CHECK(tmin == 5);
+        CHECK(tmax == 6);
+
+        tmin = 0;
+        tmax = 3;
+        CHECK_FALSE(unit.clip(ray, inv, tmin, tmax));
+    }
+}
+
+//__________________________________________________________________________________________________
+
+TEST_CASE("PPM tests", "[ppm]") {
+    const uint8_t pixels[] = { 0, 9, 10,  99, 100, 255 };
+    std::string fileData;
+
+    SECTION("Binary PPM") {
+        encodePPM(pixels, 2, 1, false, fileData);
+        CHECK(fileData == std::string("P6\n2 1\n255\n") + std::string(pixels, pixels + 6));
+    }
+
+    SECTION("ASCII PPM") {
+        encodePPM(pixels, 1, 2, true, fileData);
+        CHECK(fileData == "P3\n1 2\n255\n0 9 10\n99 100 255\n");
+    }
+}
+
+//__________________________________________________________________________________________________
+
+TEST_CASE("Arena tests", "[arena]") {
+    Arena arena;
+
+    auto address = [](void *p) { return reinterpret_cast<uintptr_t>(p); };
+
+    SECTION("Small allocations are packed") {
+        auto a = arena.allocate(8, 8);
+        auto b = arena.allocate(8, 8);
+        CHECK(address(b) == address(a) + 8);
+        CHECK(arena.stats().blocks == 1);
+        CHECK(arena.stats().used == 16);
+    }
+
+    SECTION("Cache-line alignment") {
+        arena.allocate(1, 1);
+        auto a = arena.allocate(Arena::CACHE_LINE, 8);
+        CHECK(address(a) % Arena::CACHE_LINE == 0);
+        CHECK(arena.stats().padding > 0);
+    }
+
+    SECTION("Block growth and release") {
+        auto big = arena.allocate(2 * Arena::MAX_BLOCK_SIZE, 8);
+        CHECK(big != nullptr);
+        for (auto i = 0;  i < 10000;  ++i)
+            arena.allocate(100, 8);
+        auto stats = arena.stats();
+        CHECK(stats.used == 2 * Arena::MAX_BLOCK_SIZE + 10000 * 100);
+        CHECK(stats.blocks > 1);
+        CHECK(stats.reserved >= stats.used + stats.padding);
+
+        arena.release();
+        stats = arena.stats();
+        CHECK(stats.blocks == 0);
+        CHECK(stats.reserved == 0);
+    }
+}
+
+//__________________________________________________________________________________________________
+
+TEST_CASE("PPM encoding throughput", "[.][ppm][benchmark]") {
+    // Reports the PPM encoding rate, in GB/s of source pixel data, for a 1024x1024 plane. This test
+    // is hidden; run it explicitly with the [benchmark] tag.
+
+    const int width = 1024, height = 1024, passes = 20;
+
+    std::vector<uint8_t> pixels(3 * width * height);
+    for (size_t i = 0;  i < pixels.size();  ++i)
+        pixels[i] = static_cast<uint8_t>((i * 2654435761u) >> 24);
+
+    std::string fileData;
+
+    for (auto ascii : { false, true }) {
+        auto start = std::chrono::steady_clock::now();
+        for (auto pass = 0;  pass < passes;  ++pass)
+            encodePPM(pixels.data(), width, height, ascii, fileData);
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+        auto gigabytes = static_cast<double>(passes) * pixels.size() / 1e9;
+        std::printf("%s PPM: %.2f GB/s\n", ascii ? "ASCII " : "Binary", gigabytes / seconds.count());
+        CHECK(fileData.size() > pixels.size());
+    }
+}
+
+//__________________________________________________________________________________________________
+
+TEST_CASE("Vector math throughput", "[.][vector4][benchmark]") {
+    // Microbenchmarks of the vector operations in the innermost intersection and shading loops.
+    // This test is hidden; run it explicitly with the [benchmark] tag, and compare the timings with
+    // a build that predates the inline math types to see the effect of inlining.
+
+    std::vector<Vector4> vectors;
+    std::vector<Point4>  points;
+
+    for (auto i = 0;  i < 1024;  ++i) {
+        vectors.emplace_back(0.5 + (i % 7), 1.0 - (i % 5), 0.25 * (i % 3), 2.0 + (i % 11));
+        vectors.back().normalize();
+        points.emplace_back(i % 13, -(i % 17), i % 19, 0.5 * (i % 23));
+    }
+
+    BENCHMARK("dot") {
+        double sum = 0;
+        for (size_t i = 0;  i + 1 < vectors.size();  ++i)
+            sum += dot(vectors[i], vectors[i+1]);
+        return sum;
+    };
+
+    BENCHMARK("cross") {
+        Vector4 sum { 0, 0, 0, 0 };
+        for (size_t i = 0;  i + 2 < vectors.size();  ++i)
+            sum = sum + cross(vectors[i], vectors[i+1], vectors[i+2]);
+        return sum;
+    };
+
+    BENCHMARK("operator[]") {
+        double sum = 0;
+        for (const auto &point : points)
+            for (size_t axis = 0;  axis < 4;  ++axis)
+                sum += point[axis];
+        return sum;
+    };
+
+    BENCHMARK("ray-sphere") {
+        // The same computation as HitSphere, against a unit sphere at the origin.
+        int hits = 0;
+        for (size_t i = 0;  i < points.size();  ++i) {
+            Ray4 ray(points[i], vectors[i]);
+            auto   cdir = Point4(0,0,0,0) - ray.origin;
+            double bb   = dot(cdir, ray.direction);
+            double rad  = (bb * bb) - dot(cdir, cdir) + 1;
+            if (rad >= 0 && (bb - std::sqrt(rad)) > 0)
+                ++hits;
+        }
+        return hits;
+    };
+}
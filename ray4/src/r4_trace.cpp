@@ -28,60 +28,178 @@
 
 #include "ray4.h"
 
+#include <algorithm>
+#include <vector>
+
 Color black { 0, 0, 0 };  // Used to zero out colors.
+Color white { 1, 1, 1 };  // The full weight of a primary ray.
+
+// Each thread remembers the opaque object that last blocked each light, indexed by the position of
+// the light in the light list. Neighboring shadow rays are very often blocked by the same object,
+// so it is tested first, as in the classic light buffer.
+
+static thread_local std::vector<const ObjInfo*> lastOccluder;  // Last Blocker of Each Light
 
 
 
 //__________________________________________________________________________________________________
 
-void RayTrace (
-    const Ray4 &rayIn,  // Trace Ray
-    Color      &color,  // Resulting Color
-    int         level)  // Raytrace Level
+static double AcneOffset () {
+    // Returns the distance that ray origins and shading points are moved off of a surface to avoid
+    // surface acne. Single-precision intersections need a larger offset (see MINDIST in r4_hit).
+
+    return (precision == Precision::Float) ? 1e-10 * FLOAT_TOLERANCE_SCALE : 1e-10;
+}
+
+//__________________________________________________________________________________________________
+
+static bool FindNearest (const Ray4 &ray, HitRecord &hit) {
+    // Finds the nearest intersection of the ray with the scene objects through the selected
+    // accelerator. Returns true if the hit record was updated.
+
+    switch (accel) {
+        case Accel::Grid:
+            return GridNearest (ray, hit);
+
+        case Accel::List: {
+            const auto *hitObject = hit.object;
+            for (auto optr = objlist;  optr;  optr = optr->next)
+                (*optr->intersect)(optr, ray, hit);
+            return hit.object != hitObject;
+        }
+
+        default:
+            return BVHNearest (ray, hit);
+    }
+}
+
+//__________________________________________________________________________________________________
+
+static bool FindBlocker (
+    const Ray4     &ray,      // Shadow Ray, From Surface Point Towards Light
+    double          maxdist,  // Distance to the Light (-1 for Directional Lights)
+    Color          &lcolor,   // Light Color, Filtered By Transparent Occluders
+    const ObjInfo* &blocker)  // Opaque Object Found Blocking the Light
 {
-    // This routine is the heart of the raytracer; it takes the ray, determines which objects are
-    // hit, picks the closest one, determines the appropriate shade at the surface, and then may or
-    // may not fire a reflection ray and or a refraction ray.
+    // Determines whether the shadow ray is blocked by an opaque object, through the selected
+    // accelerator, filtering the light color by any transparent objects in the way (see
+    // BVHShadow() in r4_bvh.cpp).
+
+    switch (accel) {
+        case Accel::Grid:
+            return GridShadow (ray, maxdist, lcolor, blocker);
+
+        case Accel::List:
+            for (auto optr = objlist;  optr;  optr = optr->next) {
+                if (!(*optr->occlude)(optr, ray, maxdist))
+                    continue;
+
+                if (!(optr->attr->flags & AT_TRANSPAR)) {
+                    blocker = optr;
+                    return true;
+                }
+
+                lcolor *= optr->attr->Kt;
+            }
+            return false;
+
+        default:
+            return BVHShadow (ray, maxdist, lcolor, blocker);
+    }
+}
+
+//__________________________________________________________________________________________________
+
+static bool IsShadowed (
+    const Ray4 &ray,         // Shadow Ray, From Surface Point Towards Light
+    double      maxdist,     // Distance to the Light (-1 for Directional Lights)
+    Color      &lcolor,      // Light Color, Filtered By Transparent Occluders
+    size_t      lightIndex)  // Position of the Light in the Light List
+{
+    // Determines whether the shadow ray is blocked by an opaque object, testing the object that
+    // last blocked the same light first. A shadowed light contributes nothing, so once an opaque
+    // blocker is found the filtered light color no longer matters, and the result is the same as
+    // the full search would give.
+
+    if (lightIndex >= lastOccluder.size())
+        lastOccluder.resize(lightIndex + 1, nullptr);
+
+    auto &cached = lastOccluder[lightIndex];  // Last Blocker of This Light
+
+    if (cached) {
+        ++stats.shadowCacheTests;
+
+        if ((*cached->occlude)(cached, ray, maxdist)) {
+            ++stats.shadowCacheHits;
+            return true;
+        }
+    }
+
+    // Otherwise search the scene. An unshadowed ray clears the cache, so that lit regions don't pay
+    // for a cache test on every shadow ray.
+
+    const ObjInfo *blocker = nullptr;  // Opaque Object Blocking the Light
+
+    bool shadowed = FindBlocker (ray, maxdist, lcolor, blocker);
+    cached = shadowed ? blocker : nullptr;
+
+    return shadowed;
+}
+
+//__________________________________________________________________________________________________
+
+static Ray4 StartRay (const Ray4 &rayIn, int level) {
+    // Counts the ray in the statistics, and returns the ray to trace for the given ray. The ray
+    // origin is moved a bit along the ray direction to eliminate surface acne, where floating-point
+    // roundoff erroneously puts the point inside a surface.
 
     ++ stats.Ncast;
-    ++ level;
+    ++ stats.levelRays[std::min(level, STATS_LEVELS) - 1];
+
+    if (level == 1)
+        ++ stats.Nprimary;
 
     if (level > stats.maxlevel)
         stats.maxlevel = level;
 
-    // Move the ray origin a bit along the ray direction to eliminate surface acne, where
-    // floating-point roundoff erroneously puts the point inside a surface.
-
     Ray4 ray = rayIn;
-    ray.origin = ray(1e-10);
+    ray.origin = ray(AcneOffset());
+    return ray;
+}
 
-    // Find the nearest object intersection.
+//__________________________________________________________________________________________________
 
-    ObjInfo *nearobj = nullptr;  // Nearest Object
-    Point4   nearintr{0,0,0,0};  // Nearest Object Intersection
-    Vector4  nearnormal;         // Nearest Object Normal
-    ObjInfo *optr = nullptr;     // Object List Traversal Pointer
+static bool IsNegligible (const Color &weight) {
+    // Returns true if a ray with the given path weight can't contribute enough to its pixel to be
+    // worth tracing (see the `--minWeight` option).
 
-    {
-        double mindist;  // Nearest Object Distance
+    return std::max({ weight.r, weight.g, weight.b }) < minWeight;
+}
 
-        mindist = -1.0;
+//__________________________________________________________________________________________________
 
-        for (optr = objlist;  optr;  optr = optr->next) {
-            if ((*optr->intersect)(optr, ray, &mindist, &nearintr, &nearnormal))
-                nearobj = optr;
-        }
-    }
+static void Shade (
+    const Ray4      &ray,      // Trace Ray
+    const HitRecord &nearest,  // Nearest Object Intersection
+    Color           &color,    // Resulting Color
+    int              level,    // Raytrace Level
+    const Color     &weight)   // Path Weight, the Fraction of This Color That Reaches the Pixel
+{
+    // This routine determines the appropriate shade at the nearest intersection of the ray, and
+    // then may or may not fire a reflection ray and or a refraction ray. Reflection and refraction
+    // rays whose path weight falls below the minimum weight are pruned from the ray tree.
 
     // If the ray hit nothing, assign the background color to it. If the hit an object, then
     // determine the shade at the intersection.
 
-    if (!nearobj) {
+    if (!nearest.object) {
         color = background;
         return;
     }
 
-    auto nearattr = nearobj->attr;  // Nearest Object's Attributes
+    const Point4 &nearintr   = nearest.point;         // Nearest Object Intersection
+    Vector4       nearnormal = nearest.normal;        // Nearest Object Normal
+    auto          nearattr   = nearest.object->attr;  // Nearest Object's Attributes
 
     if (nearattr->flags & AT_AMBIENT)
         color = ambient * nearattr->Ka;
@@ -106,13 +224,15 @@ void RayTrace (
         // To avoid surface acne, move the intersection point just outside the object surface to
         // prevent that same surface from erroneously shadowing itself.
 
-        Point4 intr_out = nearintr + (1e-10 * nearnormal);  // Intersection Outside The Surface
+        Point4 intr_out = nearintr + (AcneOffset() * nearnormal);  // Point Outside The Surface
 
         // Add illumation to the point from all visible lights.
 
-        for (auto *light = lightlist;  light;  light=light->next) {
+        size_t lightIndex = 0;  // Position of the Light in the Light List
+
+        for (auto *light = lightlist;  light;  light=light->next, ++lightIndex) {
             Vector4 ldir;     // Light Direction
-            double  mindist;  // Nearest Object Distance
+            double  mindist;  // Distance to Light (-1 -> Infinite)
 
             if (light->type == LightType::Directional) {
                 ldir = light->direction;
@@ -139,23 +259,14 @@ void RayTrace (
 
             auto lcolor = light->color;  // Light Color
 
-            for (optr=objlist;  optr;  optr=optr->next) {
-                double minsave=mindist;  // Nearest Object Distance (saved)
-
-                if ((*optr->intersect)(optr, Ray4(intr_out, ldir), &mindist, nullptr, nullptr)) {
-                    if (!(optr->attr->flags & AT_TRANSPAR))
-                        break;
-
-                    lcolor *= optr->attr->Kt;
-                    mindist = minsave;
-                }
-            }
+            bool shadowed = IsShadowed (Ray4(intr_out, ldir), mindist, lcolor, lightIndex);
+            ++stats.Nshadow;
 
             // If an opaque object shadows us, then skip this light source. Also, if the maximum
             // amount of light transmitted through transparent objects is less than 1/256, then this
             // light source can add nothing significant, so skip it.
 
-            if ((optr) || ((lcolor.r + lcolor.g + lcolor.b) < 0.001))
+            if (shadowed || ((lcolor.r + lcolor.g + lcolor.b) < 0.001))
                 continue;
 
             // If surface normal is turned from light, skip this light.
@@ -195,14 +306,16 @@ void RayTrace (
 
     // Find the contribution from the refraction vector, if applicable.
 
-    if (nearattr->flags & AT_TRANSPAR) {
+    if ((nearattr->flags & AT_TRANSPAR) && IsNegligible(weight * nearattr->Kt)) {
+        ++stats.Npruned;
+    } else if (nearattr->flags & AT_TRANSPAR) {
         Vector4 T = NdotD * nearnormal;
         double ftemp = global_indexref / nearattr->indexref;
 
         Vector4 RefrD = T + (ftemp * (ray.direction - T));  // Refracted Direction Vector
 
         Color Tcolor;  // Transparent Color
-        RayTrace (Ray4(nearintr, RefrD), Tcolor, level);
+        RayTrace (Ray4(nearintr, RefrD), Tcolor, level, weight * nearattr->Kt);
         ++stats.Nrefract;
 
         color += nearattr->Kt * Tcolor;
@@ -210,14 +323,114 @@ void RayTrace (
 
     // Find the contribution from the reflection vector, if applicable.
 
-    if (nearattr->flags & AT_REFLECT) {
+    if ((nearattr->flags & AT_REFLECT) && IsNegligible(weight * nearattr->Ks)) {
+        ++stats.Npruned;
+    } else if (nearattr->flags & AT_REFLECT) {
         double ftemp = 2.0 * NdotD;
         Vector4 ReflD = ray.direction - (ftemp * nearnormal);
 
         Color Rcolor;  // Reflected Color
-        RayTrace (Ray4(nearintr, ReflD), Rcolor, level);
+        RayTrace (Ray4(nearintr, ReflD), Rcolor, level, weight * nearattr->Ks);
         ++stats.Nreflect;
 
         color += nearattr->Ks * Rcolor;
     }
 }
+
+//__________________________________________________________________________________________________
+
+void RayTrace (
+    const Ray4  &rayIn,   // Trace Ray
+    Color       &color,   // Resulting Color
+    int          level,   // Raytrace Level
+    const Color &weight)  // Path Weight, the Fraction of This Color That Reaches the Pixel
+{
+    // This routine is the heart of the raytracer; it takes the ray, determines which objects are
+    // hit, picks the closest one, determines the appropriate shade at the surface, and then may or
+    // may not fire a reflection ray and or a refraction ray.
+
+    ++ level;
+
+    Ray4 ray = StartRay(rayIn, level);
+
+    HitRecord nearest;  // Nearest Object Intersection
+
+    FindNearest (ray, nearest);
+    Shade (ray, nearest, color, level, weight);
+}
+
+//__________________________________________________________________________________________________
+
+void RayTracePacket (
+    const Ray4 rays[],       // Primary Rays
+    int        count,        // Number of Rays (At Most MAX_PACKET)
+    Color      colors[],     // Resulting Colors
+    HitRecord *primaryHits)  // If Non-Null, Receives the Primary Intersections
+{
+    // This routine traces a packet of coherent primary rays together, with the same results as
+    // RayTrace() on each ray. The nearest objects are found for the whole packet in one pass, then
+    // each ray is shaded on its own. Any reflection, refraction and shadow rays are traced singly.
+    // The primary intersections may be saved for the G-buffer cache (see ShadePrimary()).
+
+    RayPacket  packet;  // Packet of Rays to Trace
+    PacketHits hits;    // Nearest Intersections
+
+    for (auto i = 0;  i < count;  ++i) {
+        packet.add(StartRay(rays[i], 1));
+        hits.t[i]      = -1.0;
+        hits.object[i] = nullptr;
+    }
+
+    // Only the hierarchy traces whole packets; the other accelerators find each ray's nearest
+    // object on its own.
+
+    if (accel == Accel::BVH) {
+        BVHNearestPacket (packet, hits);
+    } else {
+        for (auto i = 0;  i < count;  ++i) {
+            HitRecord hit;
+            FindNearest (packet.ray[i], hit);
+            hits.t[i]      = hit.t;
+            hits.object[i] = hit.object;
+        }
+    }
+
+    for (auto i = 0;  i < count;  ++i) {
+        const auto &ray = packet.ray[i];
+
+        // Fill in the rest of the hit record by intersecting the nearest object alone. Should that
+        // ever fail, fall back to finding the nearest intersection for the single ray.
+
+        HitRecord nearest;  // Nearest Object Intersection
+
+        if (hits.object[i] && !(*hits.object[i]->intersect)(hits.object[i], ray, nearest))
+            FindNearest (ray, nearest);
+
+        if (primaryHits)
+            primaryHits[i] = nearest;
+
+        Shade (ray, nearest, colors[i], 1, white);
+    }
+}
+
+//__________________________________________________________________________________________________
+
+void ShadePrimary (
+    const Ray4 rays[],    // Primary Rays
+    int        count,     // Number of Rays
+    HitRecord  hits[],    // Primary Intersections, From the G-Buffer Cache
+    Color      colors[])  // Resulting Colors
+{
+    // This routine shades primary rays whose nearest intersections are already known, with the
+    // same results as RayTracePacket(). The cached intersections don't hold the intersection
+    // points, which are recomputed here from the rays exactly as the intersection functions do.
+
+    for (auto i = 0;  i < count;  ++i) {
+        auto ray = StartRay(rays[i], 1);
+
+        if (hits[i].object)
+            hits[i].point = ray(hits[i].t);
+
+        Shade (ray, hits[i], colors[i], 1, white);
+    }
+}
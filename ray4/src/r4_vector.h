@@ -21,55 +21,243 @@
 #ifndef R4_VECTOR_H
 #define R4_VECTOR_H
 
+//==================================================================================================
+// r4_vector.h
+//
+// Vector4 is a small value type used in every intersection and shading computation, so all of its
+// operations are defined inline here, and are constexpr where the language allows. Vectors are
+// templated on their coordinate type: Vector4 has double-precision coordinates, and Vector4f has
+// single-precision coordinates for the single-precision render mode. When built with the AVX2
+// backend (see r4_simd.h), the double-precision arithmetic operations use SIMD code outside of
+// constant evaluation.
+//==================================================================================================
+
+#include "r4_simd.h"
+
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
+#include <type_traits>
 
 
 
 //__________________________________________________________________________________________________
 
-class Vector4 {
+template<typename Real>
+class Vector4T {
     // Represents a four-dimenisonal vector.
 
   public:
-    double x, y, z, w;
+    Real x, y, z, w;
+
+    Vector4T() = default;
+    constexpr Vector4T(const Vector4T&) = default;
+    ~Vector4T() = default;
+    constexpr Vector4T& operator= (const Vector4T &other) = default;
+
+    constexpr Vector4T(Real x, Real y, Real z, Real w) : x(x), y(y), z(z), w(w) {}
+
+    // Converts a vector of another precision.
+    template<typename Other>
+    constexpr explicit Vector4T(const Vector4T<Other>& v)
+      : x(static_cast<Real>(v.x)), y(static_cast<Real>(v.y)),
+        z(static_cast<Real>(v.z)), w(static_cast<Real>(v.w)) {}
+
+    // Returns the coordinate with the given index, where indices above 3 select w. The lookup
+    // goes through a table of member pointers rather than a chain of comparisons.
+    constexpr const Real& operator[] (std::size_t index) const {
+        constexpr Real Vector4T::* coordinates[]
+            { &Vector4T::x, &Vector4T::y, &Vector4T::z, &Vector4T::w };
+        return this->*coordinates[std::min<std::size_t>(index, 3)];
+    }
 
-    Vector4() = default;
-    Vector4(const Vector4&) = default;
-    ~Vector4() = default;
-    Vector4& operator= (const Vector4 &other) = default;
+    constexpr Real& operator[] (std::size_t index) {
+        constexpr Real Vector4T::* coordinates[]
+            { &Vector4T::x, &Vector4T::y, &Vector4T::z, &Vector4T::w };
+        return this->*coordinates[std::min<std::size_t>(index, 3)];
+    }
 
-    Vector4(double x, double y, double z, double w) : x(x), y(y), z(z), w(w) {}
+    constexpr bool operator== (const Vector4T& other) const {
+        return x == other.x && y == other.y && z == other.z && w == other.w;
+    }
 
-    const double& operator[] (std::size_t index) const;
-          double& operator[] (std::size_t index);
+    constexpr bool operator!= (const Vector4T& other) const {
+        return !(*this == other);
+    }
 
-    bool operator== (const Vector4& other) const;
-    bool operator!= (const Vector4& other) const;
+    constexpr Vector4T& operator*= (Real scale) {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (simdBackend) {
+            if (!std::is_constant_evaluated()) {
+                simd::store(&x, _mm256_mul_pd(simd::load(&x), simd::broadcast(scale)));
+                return *this;
+            }
+        }
+      #endif
+        x *= scale;
+        y *= scale;
+        z *= scale;
+        w *= scale;
+        return *this;
+    }
 
-    Vector4& operator*= (double scale);
-    Vector4& operator/= (double divisor);
+    constexpr Vector4T& operator/= (Real divisor) {
+        *this *= 1/divisor;
+        return *this;
+    }
 
-    Vector4 operator- () const;
-    Vector4 operator+ (const Vector4& other) const;
-    Vector4 operator- (const Vector4& other) const;
-    Vector4 operator* (double scale) const;
-    Vector4 operator/ (double divisor) const;
+    constexpr Vector4T operator- () const {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (simdBackend) {
+            if (!std::is_constant_evaluated())
+                return fromSimd(_mm256_xor_pd(simd::load(&x), simd::broadcast(-0.0)));
+        }
+      #endif
+        return {-x, -y, -z, -w};
+    }
+
+    constexpr Vector4T operator+ (const Vector4T& other) const {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (simdBackend) {
+            if (!std::is_constant_evaluated())
+                return fromSimd(_mm256_add_pd(simd::load(&x), simd::load(&other.x)));
+        }
+      #endif
+        return {x+other.x, y+other.y, z+other.z, w+other.w};
+    }
+
+    constexpr Vector4T operator- (const Vector4T& other) const {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (simdBackend) {
+            if (!std::is_constant_evaluated())
+                return fromSimd(_mm256_sub_pd(simd::load(&x), simd::load(&other.x)));
+        }
+      #endif
+        return {x-other.x, y-other.y, z-other.z, w-other.w};
+    }
+
+    constexpr Vector4T operator* (Real s) const {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (simdBackend) {
+            if (!std::is_constant_evaluated())
+                return fromSimd(_mm256_mul_pd(simd::broadcast(s), simd::load(&x)));
+        }
+      #endif
+        return {s*x, s*y, s*z, s*w};
+    }
+
+    constexpr Vector4T operator/ (Real d) const {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (simdBackend) {
+            if (!std::is_constant_evaluated())
+                return fromSimd(_mm256_div_pd(simd::load(&x), simd::broadcast(d)));
+        }
+      #endif
+        return {x/d, y/d, z/d, w/d};
+    }
 
     // If the vector length is longer than a certain tolerance, the vector is resized to a length of
     // one, and the function returns true. Otherwise, the vector is considered to have a length of
     // zero, is left unchanged, and the function returns false.
-    bool normalize();
+    bool normalize() {
+        const Real zeroLengthThreshold = static_cast<Real>(1.0e-15);
+
+        auto vecNormSquared = normSquared();
+
+        if (vecNormSquared < zeroLengthThreshold)
+            return false;
+
+        *this /= std::sqrt(vecNormSquared);
+        return true;
+    }
 
-    double normSquared() const;
-    double norm() const;
+    constexpr Real normSquared() const {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (simdBackend) {
+            if (!std::is_constant_evaluated())
+                return simd::dot(&x, &x);
+        }
+      #endif
+        return x*x + y*y + z*z + w*w;
+    }
+
+    Real norm() const {
+        return std::sqrt(normSquared());
+    }
+
+    // True if the arithmetic operations use the SIMD backend (double precision only).
+    static constexpr bool simdBackend =
+      #if defined(RAY4_SIMD_AVX2)
+        std::is_same_v<Real, double>;
+      #else
+        false;
+      #endif
+
+  #if defined(RAY4_SIMD_AVX2)
+    // Returns the vector held in the given SIMD register.
+    static Vector4T fromSimd(simd::Double4 value) {
+        Vector4T result;
+        simd::store(&result.x, value);
+        return result;
+    }
+  #endif
 };
 
+using Vector4  = Vector4T<double>;  // Double-Precision Vector
+using Vector4f = Vector4T<float>;   // Single-Precision Vector
+
 
-inline Vector4 operator* (double s, const Vector4& v) {
+template<typename Real>
+constexpr Vector4T<Real> operator* (std::type_identity_t<Real> s, const Vector4T<Real>& v) {
     return v * s;
 }
 
-double  dot   (const Vector4&, const Vector4&);
-Vector4 cross (const Vector4&, const Vector4&, const Vector4&);
+template<typename Real>
+constexpr Real dot (const Vector4T<Real>& a, const Vector4T<Real>& b) {
+      #if defined(RAY4_SIMD_AVX2)
+        if constexpr (Vector4T<Real>::simdBackend) {
+            if (!std::is_constant_evaluated())
+                return simd::dot(&a.x, &b.x);
+        }
+      #endif
+    return (a.x * b.x) + (a.y * b.y) + (a.z * b.z) + (a.w * b.w);
+}
+
+//__________________________________________________________________________________________________
+
+template<typename Real>
+constexpr Vector4T<Real> cross (const Vector4T<Real>& u, const Vector4T<Real>& v,
+                                const Vector4T<Real>& w) {
+    // This routine calculates the 4D cross product of three 4-vectors.
+
+  #if defined(RAY4_SIMD_AVX2)
+    if constexpr (Vector4T<Real>::simdBackend) {
+        if (!std::is_constant_evaluated()) {
+            Vector4T<Real> result;
+            simd::cross(&result.x, &u.x, &v.x, &w.x);
+            return result;
+        }
+    }
+  #endif
+
+    Real A = (v.x * w.y) - (v.y * w.x);  // Intermediate Values
+    Real B = (v.x * w.z) - (v.z * w.x);
+    Real C = (v.x * w.w) - (v.w * w.x);
+    Real D = (v.y * w.z) - (v.z * w.y);
+    Real E = (v.y * w.w) - (v.w * w.y);
+    Real F = (v.z * w.w) - (v.w * w.z);
+
+    return {
+          (u.y * F) - (u.z * E) + (u.w * D),
+        - (u.x * F) + (u.z * C) - (u.w * B),
+          (u.x * E) - (u.y * C) + (u.w * A),
+        - (u.x * D) + (u.y * B) - (u.z * A)
+    };
+}
+
+#if defined(RAY4_SIMD_AVX2)
+static_assert(std::is_standard_layout_v<Vector4> && sizeof(Vector4) == 4 * sizeof(double),
+              "The SIMD backend requires Vector4 coordinates to be four consecutive doubles.");
+#endif
 
 #endif
@@ -0,0 +1,159 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+
+//==================================================================================================
+// r4_writer.cpp
+//
+// This file contains the implementation of the AsyncWriter asynchronous output writer. See
+// r4_writer.h for more information.
+//==================================================================================================
+
+#include "r4_writer.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+
+//__________________________________________________________________________________________________
+
+AsyncWriter::AsyncWriter (FILE *stream, int bufferCount, size_t bufferSize)
+  : stream(stream),
+    buffers(std::max(1, bufferCount)),
+    current(-1),
+    stallTime(0)
+{
+    for (auto i = 0;  i < static_cast<int>(buffers.size());  ++i) {
+        buffers[i].data.resize(bufferSize);
+        free.push_back(i);
+    }
+
+    thread = std::thread(&AsyncWriter::writerMain, this);
+}
+
+//__________________________________________________________________________________________________
+
+AsyncWriter::~AsyncWriter () {
+    flush();
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    queued.notify_one();
+    thread.join();
+}
+
+//__________________________________________________________________________________________________
+
+bool AsyncWriter::write (const void *data, size_t size) {
+    auto bytes = static_cast<const char*>(data);
+
+    while (size > 0) {
+        // Get a buffer to fill, waiting for the writer thread to release one if they're all busy.
+
+        if (current < 0) {
+            std::unique_lock<std::mutex> guard(lock);
+
+            if (free.empty()) {
+                auto waitStart = std::chrono::steady_clock::now();
+                released.wait(guard, [this] { return !free.empty(); });
+                stallTime += std::chrono::steady_clock::now() - waitStart;
+            }
+
+            current = free.back();
+            free.pop_back();
+            buffers[current].size = 0;
+        }
+
+        auto &buffer = buffers[current];
+        auto count = std::min(size, buffer.data.size() - buffer.size);
+
+        memcpy (buffer.data.data() + buffer.size, bytes, count);
+        buffer.size += count;
+        bytes += count;
+        size  -= count;
+
+        if (buffer.size == buffer.data.size())
+            queueCurrent();
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    return !failed;
+}
+
+//__________________________________________________________________________________________________
+
+bool AsyncWriter::flush () {
+    if (current >= 0)
+        queueCurrent();
+
+    std::unique_lock<std::mutex> guard(lock);
+    released.wait(guard, [this] { return full.empty() && !writing; });
+    return !failed && (fflush(stream) == 0);
+}
+
+//__________________________________________________________________________________________________
+
+void AsyncWriter::queueCurrent () {
+    // Hands the buffer being filled to the writer thread.
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        full.push_back(current);
+    }
+    current = -1;
+    queued.notify_one();
+}
+
+//__________________________________________________________________________________________________
+
+void AsyncWriter::writerMain () {
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (true) {
+        queued.wait(guard, [this] { return !full.empty() || stopping; });
+
+        if (full.empty())
+            return;
+
+        auto index = full.front();
+        full.pop_front();
+        writing = true;
+
+        // Write the buffer without holding the lock, so the caller can keep filling buffers. After
+        // a failed write, later buffers are just discarded.
+
+        bool skip = failed;
+
+        guard.unlock();
+        auto &buffer = buffers[index];
+        bool ok = skip || (fwrite(buffer.data.data(), 1, buffer.size, stream) == buffer.size);
+        guard.lock();
+
+        if (!ok)
+            failed = true;
+
+        writing = false;
+        free.push_back(index);
+        released.notify_all();
+    }
+}
@@ -0,0 +1,97 @@
+//**************************************************************************************************
+//  Copyright (c) 1991-2024 Steven R Hollasch
+//
+//  MIT License
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+//  and associated documentation files (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all copies or
+//  substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+//  BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+//  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+//  DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//**************************************************************************************************
+#ifndef R4_WRITER_H
+#define R4_WRITER_H
+
+//==================================================================================================
+// r4_writer.h
+//
+// An asynchronous output writer, which hands filled output buffers to a background thread so that
+// the caller can keep working while earlier output is written to disk.
+//==================================================================================================
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+//__________________________________________________________________________________________________
+
+class AsyncWriter {
+    // Writes to a stdio stream through a ring of large buffers. The caller fills one buffer at a
+    // time; each full buffer is queued for the writer thread, which writes it to the stream and
+    // returns it to the ring. The caller only waits (stalls) when every buffer is in flight.
+
+  public:
+    // Creates a writer to the given open stream, with the given number (at least one) of buffers
+    // of the given size in bytes. The stream must stay open until the writer is destroyed.
+    AsyncWriter(FILE *stream, int bufferCount, size_t bufferSize);
+
+    // Writes all pending output, then stops the writer thread.
+    ~AsyncWriter();
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator= (const AsyncWriter&) = delete;
+
+    // Copies the data into the output buffers. Returns false if an earlier write to the stream
+    // failed.
+    bool write(const void *data, size_t size);
+
+    // Waits until all output so far has been written to the stream. Returns false if any write to
+    // the stream failed.
+    bool flush();
+
+    // Returns the total time, in seconds, that write() has waited for a free buffer.
+    double stallSeconds() const { return stallTime.count(); }
+
+  private:
+    struct Buffer {
+        std::vector<char> data;      // Buffer Storage
+        size_t            size {0};  // Bytes Used
+    };
+
+    void queueCurrent();
+    void writerMain();
+
+    FILE                         *stream;      // Output Stream
+    std::vector<Buffer>           buffers;     // Buffer Ring
+    int                           current;     // Buffer Being Filled (-1 -> None)
+    std::chrono::duration<double> stallTime;   // Total Time Waiting for a Free Buffer
+    std::thread                   thread;      // Writer Thread
+
+    // The following fields are guarded by lock.
+
+    std::mutex              lock;
+    std::condition_variable queued;            // Signaled when a buffer is queued, or on shutdown
+    std::condition_variable released;          // Signaled when the writer releases a buffer
+    std::deque<int>         full;              // Buffers Waiting to Be Written
+    std::vector<int>        free;              // Buffers Ready to Be Filled
+    bool                    writing { false }; // True While the Writer Thread Holds a Buffer
+    bool                    failed  { false }; // True If a Stream Write Failed
+    bool                    stopping{ false }; // True on Shutdown
+};
+
+#endif
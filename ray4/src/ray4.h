@@ -42,6 +42,7 @@
 #include <cstdint>
 #include <iostream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -51,11 +52,28 @@ using namespace std;
 
 const double epsilon = 1.0e-15;  // Very Small Number (Effectively Zero)
 
+// Surface acne tolerances are scaled up by this factor for single-precision intersection. Scaling
+// by the square root of the ratio of the machine epsilons keeps each tolerance at the same power
+// of epsilon that it was chosen at for doubles.
+
+constexpr double FLOAT_TOLERANCE_SCALE = 23170.475;  // sqrt(FLT_EPSILON / DBL_EPSILON) = 2^14.5
+
 const double pi=3.14159265358979323846;
 
 const double degreeToRadian = pi / 180.0;
 const double radianToDegree = 180.0 / pi;
 
+enum class Precision {  // Packed Primitive Intersection Precision
+    Double,
+    Float
+};
+
+enum class Accel {      // Ray Intersection Accelerator
+    BVH,                // Bounding Volume Hierarchy
+    Grid,               // Uniform 4D Grid
+    List                // Linear Scan of the Object List
+};
+
 enum class ObjType {    // Object Type ID's
     None,
     Sphere,
@@ -64,6 +82,10 @@ enum class ObjType {    // Object Type ID's
     Parallelepiped
 };
 
+const int OBJ_TYPE_COUNT = static_cast<int>(ObjType::Parallelepiped) + 1;  // Number of Object Types
+
+const int STATS_LEVELS = 16;  // Ray Tree Levels Counted Separately in the Statistics
+
 
 // Inline Utility Functions
 
@@ -83,12 +105,14 @@ inline double lerp (double a, double b, double t) {
     return a + t*(b - a);
 }
 
-#define NEW(type,num)  (type *) MyAlloc((unsigned long)(num)*sizeof(type))
-#define DELETE(addr)   MyFree ((char*)addr)
+// Scene data is allocated from the scene arena, and is only freed all at once on exit.
+
+#define NEW(type,num)  (type *) MyAlloc((size_t)(num)*sizeof(type), alignof(type))
 
 
 // Standard Ray4 Includes
 
+#include "r4_bounds.h"
 #include "r4_color.h"
 #include "r4_point.h"
 #include "r4_ray.h"
@@ -98,10 +122,48 @@ inline double lerp (double a, double b, double t) {
 // Structure Definitions
 
 struct Stats {
-    long  Ncast;     // Number of Rays Cast
-    long  Nreflect;  // Number of Reflection Rays Cast
-    long  Nrefract;  // Number of Refraction Rays Cast
-    long  maxlevel;  // Maximum Ray Tree Level
+    // Each thread gathers its own statistics, so the counters need no synchronization. They are
+    // merged into the main thread statistics as the worker threads exit.
+
+    long long  Ncast    { 0 };  // Number of Rays Cast (Primary, Reflection & Refraction)
+    long long  Nprimary { 0 };  // Number of Primary Rays Cast
+    long long  Nshadow  { 0 };  // Number of Shadow Rays Cast
+    long long  Nreflect { 0 };  // Number of Reflection Rays Cast
+    long long  Nrefract { 0 };  // Number of Refraction Rays Cast
+    long long  Npruned  { 0 };  // Number of Reflection & Refraction Rays Pruned by Weight
+    long long  Ninterp  { 0 };  // Number of Pixels Interpolated by Adaptive Subdivision
+    long long  maxlevel { 0 };  // Maximum Ray Tree Level
+
+    long long  shadowCacheTests { 0 };  // Shadow Rays Tested Against a Light's Last Blocker
+    long long  shadowCacheHits  { 0 };  // Shadow Rays Blocked by a Light's Last Blocker
+
+    long long  levelRays[STATS_LEVELS] { };  // Rays Cast per Tree Level; Last Counts All Deeper
+    long long  tests[OBJ_TYPE_COUNT]   { };  // Intersection Tests per Object Type
+    long long  hits[OBJ_TYPE_COUNT]    { };  // Intersections Found per Object Type
+
+    void merge (const Stats &other) {
+        // Accumulates the statistics gathered by another thread.
+        Ncast    += other.Ncast;
+        Nprimary += other.Nprimary;
+        Nshadow  += other.Nshadow;
+        Nreflect += other.Nreflect;
+        Nrefract += other.Nrefract;
+        Npruned  += other.Npruned;
+        Ninterp  += other.Ninterp;
+        if (maxlevel < other.maxlevel)
+            maxlevel = other.maxlevel;
+
+        shadowCacheTests += other.shadowCacheTests;
+        shadowCacheHits  += other.shadowCacheHits;
+
+        for (auto i = 0;  i < STATS_LEVELS;  ++i)
+            levelRays[i] += other.levelRays[i];
+
+        for (auto i = 0;  i < OBJ_TYPE_COUNT;  ++i) {
+            tests[i] += other.tests[i];
+            hits[i]  += other.hits[i];
+        }
+    }
 };
 
 enum class LightType { Point, Directional };
@@ -147,13 +209,83 @@ const InfoFlag FL_GOURAUD = (1 << 0);  // Set if the Object is Gouraud Shaded
 const InfoFlag FL_PHONG   = (1 << 1);  // Set if the Object is Phong Shaded
 
 
+struct ObjInfo;
+
+struct HitRecord {
+    // The description of a ray/object intersection. Each ray carries its own hit record, which the
+    // intersection functions fill in, so the scene objects are never modified during the trace.
+
+    double         t      { -1.0 };     // Intersection Ray Parameter (-1 -> No Hit Yet)
+    Point4         point;               // Intersection Point
+    Vector4        normal;              // Surface Normal at Intersection Point
+    double         Bc1, Bc2, Bc3;       // Intersection Barycentric Coordinates
+    const ObjInfo *object { nullptr };  // Object Hit
+};
+
+const int MAX_PACKET = 8;  // Maximum Number of Rays in a Ray Packet
+
+template<typename Real>
+struct RayPacketT {
+    // A bundle of rays traced together. Each ray is kept whole, and its coordinates are also laid
+    // out as structure-of-arrays, one array per coordinate, for the packet intersection functions.
+    // The coordinate arrays have the precision of the packed primitives they are tested against.
+
+    int    count { 0 };                 // Number of Rays
+    Ray4   ray[MAX_PACKET];             // Individual Rays
+    Real   ox[MAX_PACKET], oy[MAX_PACKET], oz[MAX_PACKET], ow[MAX_PACKET];  // Ray Origins
+    Real   dx[MAX_PACKET], dy[MAX_PACKET], dz[MAX_PACKET], dw[MAX_PACKET];  // Ray Directions
+
+    // Appends a ray to the packet.
+
+    void add (const Ray4 &r) {
+        ray[count] = r;
+        ox[count] = static_cast<Real>(r.origin.x);
+        oy[count] = static_cast<Real>(r.origin.y);
+        oz[count] = static_cast<Real>(r.origin.z);
+        ow[count] = static_cast<Real>(r.origin.w);
+        dx[count] = static_cast<Real>(r.direction.x);
+        dy[count] = static_cast<Real>(r.direction.y);
+        dz[count] = static_cast<Real>(r.direction.z);
+        dw[count] = static_cast<Real>(r.direction.w);
+        ++count;
+    }
+};
+
+using RayPacket  = RayPacketT<double>;  // Double-Precision Ray Packet
+using RayPacketf = RayPacketT<float>;   // Single-Precision Ray Packet
+
+struct PacketHits {
+    // The nearest intersection found so far for each ray of a packet. Only the distance and object
+    // are tracked; the remaining hit record fields are filled in once the nearest object is known.
+
+    double         t[MAX_PACKET];       // Intersection Ray Parameters (-1 -> No Hit Yet)
+    const ObjInfo *object[MAX_PACKET];  // Objects Hit
+};
+
+enum class GBufferMode { None, Read, Write };  // Primary-Ray G-Buffer Cache File Mode
+
+struct GBufferView {
+    // The ray grid of the primary rays, which together with the scene geometry determines the
+    // contents of a G-buffer cache file (see r4_gbuffer.cpp).
+
+    Point4  origin;         // Ray-Grid Origin Point
+    Vector4 gx, gy, gz;     // Ray-Grid Basis Vectors
+    int     resolution[3];  // Image Resolution
+    int     zStart;         // First Traced Image Plane
+    int     zLimit;         // One Past the Last Traced Image Plane
+};
+
 struct ObjInfo {
     ObjInfo    *next;       // Pointer to Next Object
     Attributes *attr;       // Object Attributes
     ObjType     type;       // Object Type
     InfoFlag    flags;      // Information Flags
     bool      (*intersect)  // Intersection Function
-                (ObjInfo*, const Ray4&, double*, Point4*, Vector4*);
+                (const ObjInfo*, const Ray4&, HitRecord&);
+    bool      (*occlude)    // Occlusion Function
+                (const ObjInfo*, const Ray4&, double maxdist);
+    unsigned    id;         // Object ID (Order of Definition)
+    Bounds4     bounds;     // Object Bounding Box
 };
 
 struct Sphere {
@@ -167,15 +299,14 @@ struct TetPar {            // Tetrahedron/Parallelepiped Common Fields
     Point4  vert[4];         // Vertices
     Vector4 vec1,vec2,vec3;  // Vectors from Vertex 0 to Vertices 1,2,3
     Vector4 normal;          // Hyperplane Normal Vector
-    uint8_t ax1, ax2, ax3;   // Non-Dominant Normal Vector Axes
     double  planeConst;      // Hyperplane Constant
-    double  CramerDiv;       // Cramer's-Rule Divisor for Barycentric Coords
+    Vector4 bary[3];         // Barycentric Projection Rows: Bc[k] = bary[k].P + baryConst[k]
+    double  baryConst[3];    // Barycentric Projection Constants
 };
 
 struct Tetrahedron {
-    ObjInfo info;           // Common Obj Fields; Must Be First Field
-    TetPar  tp;             // Tetrahedron/Parallelepiped Data
-    double  Bc1, Bc2, Bc3;  // Barycentric Coordinate Values
+    ObjInfo info;  // Common Obj Fields; Must Be First Field
+    TetPar  tp;    // Tetrahedron/Parallelepiped Data
 };
 
 struct Parallelepiped {
@@ -187,27 +318,104 @@ struct Triangle {
     ObjInfo  info;        // Common Object Fields; Must Be First Field
     Point4   vert[3];     // Triangle Vertices
     Vector4  vec1, vec2;  // vector from Vertex0 to Vertices 1,2.
-    double   Bc1, Bc2;    // Barycentric Coordinate Values
+    double   minor[6];    // 2x2 Minors of vec1,vec2 on Axes XY, XZ, XW, YZ, YW, ZW
 };
 
+template<typename Real>
+struct SphereArraysT {
+    // The scene spheres, packed after parsing into structure-of-arrays form, with one contiguous
+    // array per field. The type-specific intersection loops in r4_hit.cpp stream through these
+    // arrays instead of following object pointers. Spheres may be packed in double precision
+    // (SphereArrays) or single precision (SphereArraysf).
+
+    std::vector<Real>           cx, cy, cz, cw;  // Sphere Centers
+    std::vector<Real>           rsqrd;           // Sphere Radii, Squared
+    std::vector<const ObjInfo*> object;          // Sphere Objects
+
+    void     add  (const ObjInfo*);
+    uint32_t size () const { return static_cast<uint32_t>(object.size()); }
+};
+
+template<typename Real>
+struct TetParArraysT {
+    // The scene tetrahedrons and parallelepipeds, packed as for SphereArraysT. Each row of the
+    // barycentric projection (see TetPar) is kept as five arrays.
+
+    std::vector<Real>           nx, ny, nz, nw;  // Hyperplane Normal Vectors
+    std::vector<Real>           planeConst;      // Hyperplane Constants
+    std::vector<Real>           bx[3], by[3];    // Barycentric Projection Rows
+    std::vector<Real>           bz[3], bw[3];
+    std::vector<Real>           bc[3];           // Barycentric Projection Constants
+    std::vector<uint8_t>        isTetrahedron;   // 1 for Tetrahedrons, 0 for Parallelepipeds
+    std::vector<const ObjInfo*> object;          // Tetrahedron/Parallelepiped Objects
+
+    void     add  (const ObjInfo*);
+    uint32_t size () const { return static_cast<uint32_t>(object.size()); }
+};
+
+using SphereArrays  = SphereArraysT<double>;  // Double-Precision Packed Spheres
+using SphereArraysf = SphereArraysT<float>;   // Single-Precision Packed Spheres
+using TetParArrays  = TetParArraysT<double>;  // Double-Precision Packed TetPars
+using TetParArraysf = TetParArraysT<float>;   // Single-Precision Packed TetPars
+
 
 // Function Declarations
 
-void  CloseInput  ();
-void  CloseOutput ();
-void  Halt        (const char*, ...);
-bool  HitSphere   (ObjInfo*, const Ray4&, double*, Point4*, Vector4*);
-bool  HitTetPar   (ObjInfo*, const Ray4&, double*, Point4*, Vector4*);
-bool  HitTriangle (ObjInfo*, const Ray4&, double*, Point4*, Vector4*);
-char *MyAlloc     (size_t);
-void  MyFree      (void*);
-void  OpenInput   (const char* fileName);
-void  OpenOutput  (const char* fileName);
-void  ParseInput  ();
-void  RayTrace    (const Ray4&, Color&, int);
-int   ReadChar    ();
-void  UnreadChar  (int);
-void  WriteBlock  (void *block, int size);
+bool   BVHNearest      (const Ray4&, HitRecord&);
+void   BVHNearestPacket (const RayPacket&, PacketHits&);
+bool   BVHShadow       (const Ray4&, double maxdist, Color &lcolor, const ObjInfo* &blocker);
+void   BuildBVH        ();
+void   BuildGrid       ();
+void   CloseGBuffer    ();
+void   CloseInput      ();
+void   CloseOutput     ();
+void   FlushOutput     ();
+bool   GridNearest     (const Ray4&, HitRecord&);
+bool   GridShadow      (const Ray4&, double maxdist, Color &lcolor, const ObjInfo* &blocker);
+void   Halt            (const char*, ...);
+bool   HitSphere       (const ObjInfo*, const Ray4&, HitRecord&);
+bool   HitTetPar       (const ObjInfo*, const Ray4&, HitRecord&);
+bool   HitTriangle     (const ObjInfo*, const Ray4&, HitRecord&);
+char  *MyAlloc         (size_t, size_t alignment);
+bool   OccludeSphere   (const ObjInfo*, const Ray4&, double maxdist);
+bool   OccludeTetPar   (const ObjInfo*, const Ray4&, double maxdist);
+bool   OccludeTriangle (const ObjInfo*, const Ray4&, double maxdist);
+GBufferMode OpenGBuffer (const char* fileName, const GBufferView&);
+void   OpenInput       (const char* fileName);
+void   OpenOutput      (const char* fileName, int bufferCount, size_t bufferSize);
+uint64_t OutputBytesWritten ();
+double OutputStallTime ();
+void   ParseInput      ();
+void   RayTrace        (const Ray4&, Color&, int level, const Color &weight);
+void   RayTracePacket  (const Ray4 rays[], int count, Color colors[],
+                        HitRecord *primaryHits = nullptr);
+int    ReadChar        ();
+void   ReadGBuffer     (HitRecord *hits, size_t count);
+void   ShadePrimary    (const Ray4 rays[], int count, HitRecord hits[], Color colors[]);
+void   UnreadChar      (int);
+void   WriteBlock      (void *block, int size);
+void   WriteGBuffer    (const HitRecord *hits, size_t count);
+
+// Packed primitive intersection loops, instantiated in r4_hit.cpp for double and float.
+
+template<typename Real>
+void   NearestSpheres  (const SphereArraysT<Real>&, uint32_t first, uint32_t limit,
+                        const Ray4T<Real>&, double &nearestT, const ObjInfo* &nearestObject);
+template<typename Real>
+void   NearestSpheresPacket (const SphereArraysT<Real>&, uint32_t first, uint32_t limit,
+                             const RayPacketT<Real>&, PacketHits&);
+template<typename Real>
+void   NearestTetPars  (const TetParArraysT<Real>&, uint32_t first, uint32_t limit,
+                        const Ray4T<Real>&, double &nearestT, const ObjInfo* &nearestObject);
+template<typename Real>
+void   NearestTetParsPacket (const TetParArraysT<Real>&, uint32_t first, uint32_t limit,
+                             const RayPacketT<Real>&, PacketHits&);
+template<typename Real>
+uint32_t OccludingSphere (const SphereArraysT<Real>&, uint32_t first, uint32_t limit,
+                          const Ray4T<Real>&, double maxdist);
+template<typename Real>
+uint32_t OccludingTetPar (const TetParArraysT<Real>&, uint32_t first, uint32_t limit,
+                          const Ray4T<Real>&, double maxdist);
 
 
 // Global Variables
@@ -220,7 +428,7 @@ void  WriteBlock  (void *block, int size);
     Light      *lightlist = nullptr;  // Light-Source List
     ObjInfo    *objlist   = nullptr;  // Object List
 
-    Stats stats = { 0, 0, 0, 0 };  // Status Information
+    thread_local Stats stats;  // Per-Thread Status Information
 
     Color   ambient         { .0, .0, .0 };            // Ambient Light Factor
     Color   background      { .0, .0, .0 };            // Background Color
@@ -231,6 +439,10 @@ void  WriteBlock  (void *block, int size);
     double  Vangle          { 45.0 };                  // Viewing Angle
     double  global_indexref { 1.00 };                  // Global Index Refraction
     int     maxdepth        { 0 };                     // Maximum Recursion Depth
+
+    Precision precision { Precision::Double };  // Packed Primitive Intersection Precision
+    Accel     accel     { Accel::BVH };         // Ray Intersection Accelerator
+    double    minWeight { 0.0 };                // Minimum Path Weight of Traced Rays
 #else
     extern char *infile;
     extern char *outfile;
@@ -239,7 +451,7 @@ void  WriteBlock  (void *block, int size);
     extern Light      *lightlist;
     extern ObjInfo    *objlist;
 
-    extern Stats stats;
+    extern thread_local Stats stats;
 
     extern Color   ambient;
     extern Color   background;
@@ -250,6 +462,10 @@ void  WriteBlock  (void *block, int size);
     extern Vector4 Vover;
     extern Point4  Vto;
     extern Vector4 Vup;
+
+    extern Precision precision;
+    extern Accel     accel;
+    extern double    minWeight;
 #endif
 
 #endif